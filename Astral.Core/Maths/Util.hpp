@@ -2,6 +2,9 @@
 #include "math.h"
 #include "Maths/Vec2.hpp"
 #include "Linxc.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #define PI 3.1415927f
 #define DOUBLEPI 3.14159265358979323846
@@ -53,6 +56,36 @@ namespace Maths
 		amount %= 32;
 		return (value >> amount) | (value << (32 - amount));
 	}
+	u32 inline Popcount64(u64 value)
+	{
+#ifdef _MSC_VER
+		return (u32)__popcnt64(value);
+#else
+		return (u32)__builtin_popcountll(value);
+#endif
+	}
+	//undefined for 0
+	u32 inline CountTrailingZeros64(u64 value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (u32)index;
+#else
+		return (u32)__builtin_ctzll(value);
+#endif
+	}
+	//undefined for 0
+	u32 inline CountLeadingZeros64(u64 value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return 63 - (u32)index;
+#else
+		return (u32)__builtin_clzll(value);
+#endif
+	}
 	float inline LengthdirX(float len, float dirInRadians)
 	{
 		return cosf(dirInRadians) * len;
@@ -21,5 +21,8 @@
 #if defined(__SSE4_2__) || defined(__SSE4_1__) || defined(__SSE3__) || defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64) || defined(_M_IX86_FP)
 #define USE_SSE
 #endif
+#if defined(__AVX2__)
+#define USE_AVX2
+#endif
 
 #endif
@@ -0,0 +1,757 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "threading.hpp"
+
+//Files being read at once by io_uring, which is also the size of its submission queue
+#ifndef ASYNCIO_DEFAULT_QUEUE_DEPTH
+#define ASYNCIO_DEFAULT_QUEUE_DEPTH 256
+#endif
+//Most threads reading files at once when io_uring is not available (other platforms, old kernels, or blocked by a sandbox)
+#ifndef ASYNCIO_FALLBACK_THREADS
+#define ASYNCIO_FALLBACK_THREADS 16
+#endif
+
+//Batched asynchronous file reading. A batch of requests is handed to the reader, which opens, reads and closes every file
+//with as many in flight at once as the queue depth allows, so loading thousands of small files is no longer one syscall round trip after another.
+//On Linux this uses io_uring through raw syscalls (no liburing), where the opens and reads are submitted in batches
+//and progress is only made while the reader is polled or waited on. Elsewhere, or if io_uring cannot be set up, a pool of threads does blocking reads.
+//The pool is started by the first batch, grows to fit larger ones up to ASYNCIO_FALLBACK_THREADS, and sleeps between batches until the reader is destroyed.
+//Define ASYNCIO_NO_IO_URING to always use the threads.
+//A reader is not thread safe: beginning, polling and waiting must only be done from one thread at a time.
+
+namespace io
+{
+    struct AsyncFileRead;
+    def_delegate(AsyncFileReadCallback, void, AsyncFileRead*);
+
+    struct AsyncFileRead
+    {
+        const char *path;
+        //Where to read to. If NULL, a buffer for the rest of the file after offset (plus a null terminator, as ReadFile adds)
+        //is allocated from the batch's allocator, which must then be freed by the caller
+        u8 *buffer;
+        //Capacity of buffer, or once done the size of the allocated buffer without its terminator
+        usize bufferSize;
+        //Position in the file to start reading from
+        u64 offset;
+
+        usize bytesRead;
+        //0 on success, otherwise the errno (or GetLastError on Windows) of the step that failed
+        i32 error;
+        //Set to 1 once the request has finished, successfully or not
+        volatile i32 completed;
+        //Called once the request has finished, on the thread that polled the reader or on a fallback thread. May be NULL
+        AsyncFileReadCallback onComplete;
+        void *userData;
+
+        AsyncFileRead()
+        {
+            path = NULL;
+            buffer = NULL;
+            bufferSize = 0;
+            offset = 0;
+            bytesRead = 0;
+            error = 0;
+            completed = 0;
+            onComplete = NULL;
+            userData = NULL;
+        }
+        //Reads the whole file into a buffer allocated for it
+        AsyncFileRead(const char *path)
+        {
+            this->path = path;
+            buffer = NULL;
+            bufferSize = 0;
+            offset = 0;
+            bytesRead = 0;
+            error = 0;
+            completed = 0;
+            onComplete = NULL;
+            userData = NULL;
+        }
+        //Reads up to bufferSize bytes from the start of the file into buffer
+        AsyncFileRead(const char *path, u8 *buffer, usize bufferSize)
+        {
+            this->path = path;
+            this->buffer = buffer;
+            this->bufferSize = bufferSize;
+            offset = 0;
+            bytesRead = 0;
+            error = 0;
+            completed = 0;
+            onComplete = NULL;
+            userData = NULL;
+        }
+        inline bool Succeeded()
+        {
+            return threading::AtomicLoad32(&completed, threading::MemoryOrder_Acquire) != 0 && error == 0;
+        }
+    };
+
+    typedef struct AsyncFileReaderImpl *AsyncFileReader;
+
+    //queueDepth of 0 uses ASYNCIO_DEFAULT_QUEUE_DEPTH
+    AsyncFileReader CreateAsyncFileReader(IAllocator allocator, u32 queueDepth);
+    //Waits for the current batch, if any, before freeing the reader
+    void DestroyAsyncFileReader(AsyncFileReader reader);
+    //Whether requests go through io_uring rather than the fallback threads
+    bool AsyncFileReaderUsesIoUring(AsyncFileReader reader);
+
+    //Starts reading every request. Requests and their paths must stay alive until the batch is done,
+    //and a reader handles one batch at a time. bufferAllocator is only used for requests without a buffer,
+    //and is never called from two threads at once, so an ArenaAllocator is fine
+    void BeginFileReads(AsyncFileReader reader, AsyncFileRead *requests, usize count, IAllocator bufferAllocator);
+    //Makes what progress it can without blocking, and returns how many requests of the batch have completed.
+    //io_uring only advances while polled or waited on, so poll regularly when doing other work in between
+    usize PollFileReads(AsyncFileReader reader);
+    //Blocks until every request of the batch has completed
+    void WaitForFileReads(AsyncFileReader reader);
+    //Begins and waits for a batch
+    void ReadFiles(AsyncFileReader reader, AsyncFileRead *requests, usize count, IAllocator bufferAllocator);
+}
+
+#ifdef ASTRALCORE_ASYNCIO_IMPL
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef WINDOWS
+#include "windows.h"
+#endif
+#ifdef POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+#if defined(__linux__) && !defined(ASYNCIO_NO_IO_URING)
+#define ASYNCIO_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace io
+{
+    enum AsyncFileReadStage
+    {
+        AsyncFileReadStage_Open,
+        AsyncFileReadStage_Read,
+        AsyncFileReadStage_Close
+    };
+    //a request being worked on by io_uring
+    struct AsyncFileReadSlot
+    {
+        usize requestIndex;
+        i32 fd;
+        AsyncFileReadStage stage;
+        bool allocatedBuffer;
+    };
+
+    typedef struct AsyncFileReaderImpl
+    {
+        IAllocator allocator;
+        u32 queueDepth;
+        bool usingIoUring;
+
+        AsyncFileRead *requests;
+        usize requestCount;
+        IAllocator bufferAllocator;
+        volatile i64 nextRequest;
+        volatile i64 completedCount;
+        bool batchActive;
+
+        //fallback threads, and the lock they share bufferAllocator with
+        threading::Thread threads[ASYNCIO_FALLBACK_THREADS];
+        u32 threadCount;
+        threading::Mutex allocatorLock;
+        //each unit released sends one thread through the current batch, or out of the pool once stopping is set
+        threading::Semaphore batchStart;
+        //threads still going through the batch. The last one to finish sets batchDone
+        volatile i32 busyThreads;
+        threading::Event batchDone;
+        volatile i32 stopping;
+
+#ifdef ASYNCIO_IO_URING
+        i32 ringFd;
+        u8 *submissionRing;
+        usize submissionRingSize;
+        u8 *completionRing;
+        usize completionRingSize;
+        struct io_uring_sqe *submissionEntries;
+        usize submissionEntriesSize;
+        volatile u32 *submissionTail;
+        u32 submissionMask;
+        u32 *submissionArray;
+        volatile u32 *completionHead;
+        volatile u32 *completionTail;
+        u32 completionMask;
+        struct io_uring_cqe *completionEntries;
+        //entries written since the last io_uring_enter
+        u32 unsubmitted;
+
+        AsyncFileReadSlot *slots;
+        u32 *freeSlots;
+        u32 freeSlotCount;
+#endif
+    } AsyncFileReaderImpl;
+
+    void FinishFileRead(AsyncFileReader reader, AsyncFileRead *request)
+    {
+        threading::AtomicStore32(&request->completed, 1, threading::MemoryOrder_Release);
+        threading::AtomicFetchAdd64(&reader->completedCount, 1);
+        if (request->onComplete != NULL)
+        {
+            request->onComplete(request);
+        }
+    }
+
+    //Fallback: every thread takes requests in turn and reads them with ordinary blocking calls
+
+#ifdef WINDOWS
+    void ReadFileBlocking(AsyncFileReader reader, AsyncFileRead *request)
+    {
+        HANDLE file = CreateFileA(request->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            request->error = (i32)GetLastError();
+            return;
+        }
+        if (request->buffer == NULL)
+        {
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize))
+            {
+                request->error = (i32)GetLastError();
+                CloseHandle(file);
+                return;
+            }
+            usize size = (u64)fileSize.QuadPart > request->offset ? (usize)((u64)fileSize.QuadPart - request->offset) : 0;
+            reader->allocatorLock.Lock();
+            request->buffer = (u8*)reader->bufferAllocator.Allocate(size + 1);
+            reader->allocatorLock.Unlock();
+            if (request->buffer == NULL)
+            {
+                request->error = ERROR_NOT_ENOUGH_MEMORY;
+                CloseHandle(file);
+                return;
+            }
+            request->bufferSize = size;
+            request->buffer[size] = 0;
+        }
+        while (request->bytesRead < request->bufferSize)
+        {
+            usize remaining = request->bufferSize - request->bytesRead;
+            DWORD toRead = remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining;
+            u64 position = request->offset + request->bytesRead;
+            OVERLAPPED overlapped;
+            memset(&overlapped, 0, sizeof(OVERLAPPED));
+            overlapped.Offset = (DWORD)position;
+            overlapped.OffsetHigh = (DWORD)(position >> 32);
+            DWORD read = 0;
+            if (!::ReadFile(file, request->buffer + request->bytesRead, toRead, &read, &overlapped))
+            {
+                DWORD error = GetLastError();
+                if (error != ERROR_HANDLE_EOF)
+                {
+                    request->error = (i32)error;
+                }
+                break;
+            }
+            if (read == 0)
+            {
+                break;
+            }
+            request->bytesRead += read;
+        }
+        CloseHandle(file);
+    }
+#else
+    void ReadFileBlocking(AsyncFileReader reader, AsyncFileRead *request)
+    {
+        int fd = open(request->path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            request->error = errno;
+            return;
+        }
+        if (request->buffer == NULL)
+        {
+            struct stat status;
+            if (fstat(fd, &status) != 0)
+            {
+                request->error = errno;
+                close(fd);
+                return;
+            }
+            usize size = (u64)status.st_size > request->offset ? (usize)((u64)status.st_size - request->offset) : 0;
+            reader->allocatorLock.Lock();
+            request->buffer = (u8*)reader->bufferAllocator.Allocate(size + 1);
+            reader->allocatorLock.Unlock();
+            if (request->buffer == NULL)
+            {
+                request->error = ENOMEM;
+                close(fd);
+                return;
+            }
+            request->bufferSize = size;
+            request->buffer[size] = 0;
+        }
+        while (request->bytesRead < request->bufferSize)
+        {
+            ssize_t bytes = pread(fd, request->buffer + request->bytesRead, request->bufferSize - request->bytesRead, (off_t)(request->offset + request->bytesRead));
+            if (bytes < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                request->error = errno;
+                break;
+            }
+            if (bytes == 0)
+            {
+                break;
+            }
+            request->bytesRead += (usize)bytes;
+        }
+        close(fd);
+    }
+#endif
+
+    THREAD_RESULT AsyncFileReaderThread(void *args)
+    {
+        AsyncFileReader reader = (AsyncFileReader)args;
+        while (true)
+        {
+            reader->batchStart.Acquire();
+            if (threading::AtomicLoad32(&reader->stopping, threading::MemoryOrder_Acquire) != 0)
+            {
+                break;
+            }
+            while (true)
+            {
+                i64 index = threading::AtomicFetchAdd64(&reader->nextRequest, 1);
+                if (index >= (i64)reader->requestCount)
+                {
+                    break;
+                }
+                AsyncFileRead *request = &reader->requests[index];
+                ReadFileBlocking(reader, request);
+                FinishFileRead(reader, request);
+            }
+            //set only once every thread is done, so no callback is still running when the batch is waited on
+            if (threading::AtomicFetchAdd32(&reader->busyThreads, -1, threading::MemoryOrder_AcqRel) == 1)
+            {
+                reader->batchDone.Set();
+            }
+        }
+        return (THREAD_RESULT)0;
+    }
+
+#ifdef ASYNCIO_IO_URING
+    bool IoUringSetup(AsyncFileReader reader)
+    {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        long fd = syscall(__NR_io_uring_setup, reader->queueDepth, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        reader->ringFd = (i32)fd;
+
+        //opening, reading and closing through the ring needs 5.6 or newer, which the probe itself also needs
+        usize probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+        struct io_uring_probe *probe = (struct io_uring_probe*)reader->allocator.Allocate(probeSize);
+        memset(probe, 0, probeSize);
+        bool supported = syscall(__NR_io_uring_register, reader->ringFd, IORING_REGISTER_PROBE, probe, 256) == 0;
+        supported = supported && probe->last_op >= IORING_OP_CLOSE;
+        supported = supported && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) != 0;
+        supported = supported && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+        supported = supported && (probe->ops[IORING_OP_CLOSE].flags & IO_URING_OP_SUPPORTED) != 0;
+        reader->allocator.FREEPTR(probe);
+        if (!supported)
+        {
+            close(reader->ringFd);
+            return false;
+        }
+
+        reader->submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+        reader->completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            if (reader->completionRingSize > reader->submissionRingSize)
+            {
+                reader->submissionRingSize = reader->completionRingSize;
+            }
+            reader->completionRingSize = reader->submissionRingSize;
+        }
+        reader->submissionRing = (u8*)mmap(NULL, reader->submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ringFd, IORING_OFF_SQ_RING);
+        if (reader->submissionRing == MAP_FAILED)
+        {
+            close(reader->ringFd);
+            return false;
+        }
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            reader->completionRing = reader->submissionRing;
+        }
+        else
+        {
+            reader->completionRing = (u8*)mmap(NULL, reader->completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ringFd, IORING_OFF_CQ_RING);
+            if (reader->completionRing == MAP_FAILED)
+            {
+                munmap(reader->submissionRing, reader->submissionRingSize);
+                close(reader->ringFd);
+                return false;
+            }
+        }
+        reader->submissionEntriesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        reader->submissionEntries = (struct io_uring_sqe*)mmap(NULL, reader->submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ringFd, IORING_OFF_SQES);
+        if (reader->submissionEntries == MAP_FAILED)
+        {
+            if (reader->completionRing != reader->submissionRing)
+            {
+                munmap(reader->completionRing, reader->completionRingSize);
+            }
+            munmap(reader->submissionRing, reader->submissionRingSize);
+            close(reader->ringFd);
+            return false;
+        }
+
+        reader->submissionTail = (volatile u32*)(reader->submissionRing + params.sq_off.tail);
+        reader->submissionMask = *(u32*)(reader->submissionRing + params.sq_off.ring_mask);
+        reader->submissionArray = (u32*)(reader->submissionRing + params.sq_off.array);
+        reader->completionHead = (volatile u32*)(reader->completionRing + params.cq_off.head);
+        reader->completionTail = (volatile u32*)(reader->completionRing + params.cq_off.tail);
+        reader->completionMask = *(u32*)(reader->completionRing + params.cq_off.ring_mask);
+        reader->completionEntries = (struct io_uring_cqe*)(reader->completionRing + params.cq_off.cqes);
+        reader->unsubmitted = 0;
+
+        //the kernel may round the queue up, but never more requests are in flight than were asked for
+        reader->slots = (AsyncFileReadSlot*)reader->allocator.Allocate(sizeof(AsyncFileReadSlot) * reader->queueDepth);
+        reader->freeSlots = (u32*)reader->allocator.Allocate(sizeof(u32) * reader->queueDepth);
+        reader->freeSlotCount = reader->queueDepth;
+        for (u32 i = 0; i < reader->queueDepth; i++)
+        {
+            reader->freeSlots[i] = reader->queueDepth - 1 - i;
+        }
+        return true;
+    }
+    void IoUringDestroy(AsyncFileReader reader)
+    {
+        munmap(reader->submissionEntries, reader->submissionEntriesSize);
+        if (reader->completionRing != reader->submissionRing)
+        {
+            munmap(reader->completionRing, reader->completionRingSize);
+        }
+        munmap(reader->submissionRing, reader->submissionRingSize);
+        close(reader->ringFd);
+        reader->allocator.FREEPTR(reader->slots);
+        reader->allocator.FREEPTR(reader->freeSlots);
+    }
+
+    //there is never more than one entry per slot waiting, so the queue cannot be full
+    struct io_uring_sqe *IoUringNextEntry(AsyncFileReader reader, u32 slotIndex)
+    {
+        u32 tail = *reader->submissionTail;
+        u32 index = tail & reader->submissionMask;
+        struct io_uring_sqe *entry = &reader->submissionEntries[index];
+        memset(entry, 0, sizeof(struct io_uring_sqe));
+        entry->user_data = slotIndex;
+        reader->submissionArray[index] = index;
+        return entry;
+    }
+    inline void IoUringPushEntry(AsyncFileReader reader)
+    {
+        //publishes the entry to the kernel
+        threading::AtomicStore32((volatile i32*)reader->submissionTail, (i32)(*reader->submissionTail + 1), threading::MemoryOrder_Release);
+        reader->unsubmitted++;
+    }
+    void IoUringSubmitRead(AsyncFileReader reader, u32 slotIndex)
+    {
+        AsyncFileReadSlot *slot = &reader->slots[slotIndex];
+        AsyncFileRead *request = &reader->requests[slot->requestIndex];
+        usize remaining = request->bufferSize - request->bytesRead;
+        slot->stage = AsyncFileReadStage_Read;
+        struct io_uring_sqe *entry = IoUringNextEntry(reader, slotIndex);
+        entry->opcode = IORING_OP_READ;
+        entry->fd = slot->fd;
+        entry->addr = (u64)(usize)(request->buffer + request->bytesRead);
+        entry->len = remaining > 0x40000000 ? 0x40000000 : (u32)remaining;
+        entry->off = request->offset + request->bytesRead;
+        IoUringPushEntry(reader);
+    }
+    void IoUringSubmitClose(AsyncFileReader reader, u32 slotIndex)
+    {
+        AsyncFileReadSlot *slot = &reader->slots[slotIndex];
+        slot->stage = AsyncFileReadStage_Close;
+        struct io_uring_sqe *entry = IoUringNextEntry(reader, slotIndex);
+        entry->opcode = IORING_OP_CLOSE;
+        entry->fd = slot->fd;
+        IoUringPushEntry(reader);
+    }
+    void IoUringFinish(AsyncFileReader reader, u32 slotIndex)
+    {
+        AsyncFileReadSlot *slot = &reader->slots[slotIndex];
+        AsyncFileRead *request = &reader->requests[slot->requestIndex];
+        if (slot->allocatedBuffer)
+        {
+            request->buffer[request->bytesRead] = 0;
+        }
+        reader->freeSlots[reader->freeSlotCount++] = slotIndex;
+        FinishFileRead(reader, request);
+    }
+    //starts opening requests for as many free slots as there are
+    void IoUringStartRequests(AsyncFileReader reader)
+    {
+        while (reader->freeSlotCount > 0 && (usize)reader->nextRequest < reader->requestCount)
+        {
+            u32 slotIndex = reader->freeSlots[--reader->freeSlotCount];
+            AsyncFileReadSlot *slot = &reader->slots[slotIndex];
+            slot->requestIndex = (usize)threading::AtomicFetchAdd64(&reader->nextRequest, 1, threading::MemoryOrder_Relaxed);
+            slot->fd = -1;
+            slot->stage = AsyncFileReadStage_Open;
+            slot->allocatedBuffer = false;
+            AsyncFileRead *request = &reader->requests[slot->requestIndex];
+            struct io_uring_sqe *entry = IoUringNextEntry(reader, slotIndex);
+            entry->opcode = IORING_OP_OPENAT;
+            entry->fd = AT_FDCWD;
+            entry->addr = (u64)(usize)request->path;
+            entry->open_flags = O_RDONLY | O_CLOEXEC;
+            IoUringPushEntry(reader);
+        }
+    }
+    void IoUringComplete(AsyncFileReader reader, u32 slotIndex, i32 result)
+    {
+        AsyncFileReadSlot *slot = &reader->slots[slotIndex];
+        AsyncFileRead *request = &reader->requests[slot->requestIndex];
+        if (slot->stage == AsyncFileReadStage_Open)
+        {
+            if (result < 0)
+            {
+                request->error = -result;
+                IoUringFinish(reader, slotIndex);
+                return;
+            }
+            slot->fd = result;
+            if (request->buffer == NULL)
+            {
+                //the file was only just opened, so its size is cached and a direct fstat does not block
+                struct stat status;
+                if (fstat(slot->fd, &status) != 0)
+                {
+                    request->error = errno;
+                    IoUringSubmitClose(reader, slotIndex);
+                    return;
+                }
+                usize size = (u64)status.st_size > request->offset ? (usize)((u64)status.st_size - request->offset) : 0;
+                request->buffer = (u8*)reader->bufferAllocator.Allocate(size + 1);
+                if (request->buffer == NULL)
+                {
+                    request->error = ENOMEM;
+                    IoUringSubmitClose(reader, slotIndex);
+                    return;
+                }
+                request->bufferSize = size;
+                slot->allocatedBuffer = true;
+            }
+            if (request->bufferSize == 0)
+            {
+                IoUringSubmitClose(reader, slotIndex);
+            }
+            else IoUringSubmitRead(reader, slotIndex);
+        }
+        else if (slot->stage == AsyncFileReadStage_Read)
+        {
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                IoUringSubmitRead(reader, slotIndex);
+                return;
+            }
+            if (result < 0)
+            {
+                request->error = -result;
+                IoUringSubmitClose(reader, slotIndex);
+                return;
+            }
+            request->bytesRead += (usize)result;
+            //a short read is either the end of the file or needs continuing
+            if (result > 0 && request->bytesRead < request->bufferSize)
+            {
+                IoUringSubmitRead(reader, slotIndex);
+            }
+            else IoUringSubmitClose(reader, slotIndex);
+        }
+        else IoUringFinish(reader, slotIndex);
+    }
+    //handles every completion waiting in the ring, returning how many there were
+    u32 IoUringReap(AsyncFileReader reader)
+    {
+        u32 head = *reader->completionHead;
+        u32 tail = (u32)threading::AtomicLoad32((volatile i32*)reader->completionTail, threading::MemoryOrder_Acquire);
+        u32 reaped = 0;
+        while (head != tail)
+        {
+            struct io_uring_cqe *entry = &reader->completionEntries[head & reader->completionMask];
+            u32 slotIndex = (u32)entry->user_data;
+            i32 result = entry->res;
+            head++;
+            //hand the entry back before acting on it, since acting may queue more submissions
+            threading::AtomicStore32((volatile i32*)reader->completionHead, (i32)head, threading::MemoryOrder_Release);
+            IoUringComplete(reader, slotIndex, result);
+            reaped++;
+        }
+        return reaped;
+    }
+    //submits queued entries and, if wait is set, sleeps until at least one completion is ready
+    void IoUringEnter(AsyncFileReader reader, bool wait)
+    {
+        while (true)
+        {
+            u32 flags = wait ? IORING_ENTER_GETEVENTS : 0;
+            long submitted = syscall(__NR_io_uring_enter, reader->ringFd, reader->unsubmitted, wait ? 1 : 0, flags, NULL, 0);
+            if (submitted >= 0)
+            {
+                reader->unsubmitted -= (u32)submitted;
+                return;
+            }
+            //EAGAIN and EBUSY mean the kernel wants completions reaped first, which the caller does next
+            if (errno != EINTR)
+            {
+                return;
+            }
+        }
+    }
+#endif
+
+    AsyncFileReader CreateAsyncFileReader(IAllocator allocator, u32 queueDepth)
+    {
+        AsyncFileReader reader = (AsyncFileReader)allocator.Allocate(sizeof(AsyncFileReaderImpl));
+        reader->allocator = allocator;
+        reader->queueDepth = queueDepth == 0 ? ASYNCIO_DEFAULT_QUEUE_DEPTH : queueDepth;
+        reader->requests = NULL;
+        reader->requestCount = 0;
+        reader->bufferAllocator = IAllocator();
+        reader->nextRequest = 0;
+        reader->completedCount = 0;
+        reader->batchActive = false;
+        reader->threadCount = 0;
+        reader->allocatorLock = threading::Mutex();
+        reader->batchStart = threading::Semaphore();
+        reader->busyThreads = 0;
+        reader->batchDone = threading::Event(true);
+        reader->stopping = 0;
+        reader->usingIoUring = false;
+#ifdef ASYNCIO_IO_URING
+        reader->usingIoUring = IoUringSetup(reader);
+#endif
+        return reader;
+    }
+    void DestroyAsyncFileReader(AsyncFileReader reader)
+    {
+        WaitForFileReads(reader);
+#ifdef ASYNCIO_IO_URING
+        if (reader->usingIoUring)
+        {
+            IoUringDestroy(reader);
+        }
+#endif
+        threading::AtomicStore32(&reader->stopping, 1, threading::MemoryOrder_Release);
+        reader->batchStart.Release((i32)reader->threadCount);
+        for (u32 i = 0; i < reader->threadCount; i++)
+        {
+            threading::JoinThread(reader->threads[i]);
+        }
+        IAllocator allocator = reader->allocator;
+        allocator.FREEPTR(reader);
+    }
+    bool AsyncFileReaderUsesIoUring(AsyncFileReader reader)
+    {
+        return reader->usingIoUring;
+    }
+
+    void BeginFileReads(AsyncFileReader reader, AsyncFileRead *requests, usize count, IAllocator bufferAllocator)
+    {
+        WaitForFileReads(reader);
+        for (usize i = 0; i < count; i++)
+        {
+            requests[i].bytesRead = 0;
+            requests[i].error = 0;
+            requests[i].completed = 0;
+        }
+        reader->requests = requests;
+        reader->requestCount = count;
+        reader->bufferAllocator = bufferAllocator;
+        reader->nextRequest = 0;
+        reader->completedCount = 0;
+        reader->batchActive = true;
+#ifdef ASYNCIO_IO_URING
+        if (reader->usingIoUring)
+        {
+            IoUringStartRequests(reader);
+            IoUringEnter(reader, false);
+            return;
+        }
+#endif
+        u32 batchThreads = count < ASYNCIO_FALLBACK_THREADS ? (u32)count : ASYNCIO_FALLBACK_THREADS;
+        while (reader->threadCount < batchThreads)
+        {
+            reader->threads[reader->threadCount] = threading::StartThread(&AsyncFileReaderThread, reader);
+            reader->threadCount++;
+        }
+        reader->busyThreads = (i32)batchThreads;
+        //releasing the semaphore publishes the batch to the threads
+        reader->batchStart.Release((i32)batchThreads);
+    }
+    usize PollFileReads(AsyncFileReader reader)
+    {
+#ifdef ASYNCIO_IO_URING
+        if (reader->usingIoUring && reader->batchActive)
+        {
+            IoUringReap(reader);
+            IoUringStartRequests(reader);
+            if (reader->unsubmitted > 0)
+            {
+                IoUringEnter(reader, false);
+            }
+        }
+#endif
+        return (usize)threading::AtomicLoad64(&reader->completedCount, threading::MemoryOrder_Acquire);
+    }
+    void WaitForFileReads(AsyncFileReader reader)
+    {
+        if (!reader->batchActive)
+        {
+            return;
+        }
+#ifdef ASYNCIO_IO_URING
+        if (reader->usingIoUring)
+        {
+            while ((usize)reader->completedCount < reader->requestCount)
+            {
+                u32 reaped = IoUringReap(reader);
+                IoUringStartRequests(reader);
+                if ((usize)reader->completedCount < reader->requestCount && (reaped == 0 || reader->unsubmitted > 0))
+                {
+                    IoUringEnter(reader, reaped == 0);
+                }
+            }
+            reader->batchActive = false;
+            return;
+        }
+#endif
+        if (reader->requestCount > 0)
+        {
+            reader->batchDone.Wait();
+        }
+        reader->batchActive = false;
+    }
+    void ReadFiles(AsyncFileReader reader, AsyncFileRead *requests, usize count, IAllocator bufferAllocator)
+    {
+        BeginFileReads(reader, requests, count, bufferAllocator);
+        WaitForFileReads(reader);
+    }
+}
+#endif
\ No newline at end of file
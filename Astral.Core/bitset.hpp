@@ -0,0 +1,478 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "option.hpp"
+#include "Maths/Util.hpp"
+#include "Maths/simd.h"
+#include <string.h>
+#include <assert.h>
+
+#ifndef foreach
+#define foreach(instance, iterator) for (auto instance = iterator.Next(); !iterator.completed; instance = iterator.Next())
+#endif
+
+#define BITSET_WORD_BITS 64
+
+namespace collections
+{
+    //word level kernels shared by bitset. They process 4 words per step with AVX2, 2 with SSE and fall back to scalar code for the tail
+    struct BitsetAndOp
+    {
+        static inline u64 Scalar(u64 A, u64 B) { return A & B; }
+#ifdef USE_AVX2
+        static inline __m256i Wide(__m256i A, __m256i B) { return _mm256_and_si256(A, B); }
+#elif defined(USE_SSE)
+        static inline __m128i Wide(__m128i A, __m128i B) { return _mm_and_si128(A, B); }
+#endif
+    };
+    struct BitsetOrOp
+    {
+        static inline u64 Scalar(u64 A, u64 B) { return A | B; }
+#ifdef USE_AVX2
+        static inline __m256i Wide(__m256i A, __m256i B) { return _mm256_or_si256(A, B); }
+#elif defined(USE_SSE)
+        static inline __m128i Wide(__m128i A, __m128i B) { return _mm_or_si128(A, B); }
+#endif
+    };
+    struct BitsetXorOp
+    {
+        static inline u64 Scalar(u64 A, u64 B) { return A ^ B; }
+#ifdef USE_AVX2
+        static inline __m256i Wide(__m256i A, __m256i B) { return _mm256_xor_si256(A, B); }
+#elif defined(USE_SSE)
+        static inline __m128i Wide(__m128i A, __m128i B) { return _mm_xor_si128(A, B); }
+#endif
+    };
+    struct BitsetAndNotOp
+    {
+        static inline u64 Scalar(u64 A, u64 B) { return A & ~B; }
+        //andnot intrinsics negate their first operand
+#ifdef USE_AVX2
+        static inline __m256i Wide(__m256i A, __m256i B) { return _mm256_andnot_si256(B, A); }
+#elif defined(USE_SSE)
+        static inline __m128i Wide(__m128i A, __m128i B) { return _mm_andnot_si128(B, A); }
+#endif
+    };
+
+    template<typename Op>
+    inline void BitsetApply(u64 *destination, u64 *source, usize wordsCount)
+    {
+        usize i = 0;
+#ifdef USE_AVX2
+        for (; i + 4 <= wordsCount; i += 4)
+        {
+            __m256i A = _mm256_loadu_si256((__m256i*)(destination + i));
+            __m256i B = _mm256_loadu_si256((__m256i*)(source + i));
+            _mm256_storeu_si256((__m256i*)(destination + i), Op::Wide(A, B));
+        }
+#elif defined(USE_SSE)
+        for (; i + 2 <= wordsCount; i += 2)
+        {
+            __m128i A = _mm_loadu_si128((__m128i*)(destination + i));
+            __m128i B = _mm_loadu_si128((__m128i*)(source + i));
+            _mm_storeu_si128((__m128i*)(destination + i), Op::Wide(A, B));
+        }
+#endif
+        for (; i < wordsCount; i++)
+        {
+            destination[i] = Op::Scalar(destination[i], source[i]);
+        }
+    }
+
+#ifdef USE_AVX2
+    //nibble lookup popcount over 4 words at a time (Mula et al.), summed into 64 bit lanes with sad_epu8
+    inline __m256i BitsetPopcount256(__m256i value)
+    {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowMask = _mm256_set1_epi8(0x0f);
+        __m256i low = _mm256_and_si256(value, lowMask);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(value, 4), lowMask);
+        __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+        return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+    }
+#endif
+
+    //counts the set bits of A & B, or of A alone if B is NULL
+    inline usize BitsetPopcount(u64 *A, u64 *B, usize wordsCount)
+    {
+        usize i = 0;
+        usize result = 0;
+#ifdef USE_AVX2
+        __m256i accumulator = _mm256_setzero_si256();
+        for (; i + 4 <= wordsCount; i += 4)
+        {
+            __m256i value = _mm256_loadu_si256((__m256i*)(A + i));
+            if (B != NULL)
+            {
+                value = _mm256_and_si256(value, _mm256_loadu_si256((__m256i*)(B + i)));
+            }
+            accumulator = _mm256_add_epi64(accumulator, BitsetPopcount256(value));
+        }
+        u64 lanes[4];
+        _mm256_storeu_si256((__m256i*)lanes, accumulator);
+        result = (usize)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#else
+        //independent accumulators let the popcnt instructions overlap
+        usize counts[4] = {0, 0, 0, 0};
+        for (; i + 4 <= wordsCount; i += 4)
+        {
+            if (B != NULL)
+            {
+                counts[0] += Maths::Popcount64(A[i] & B[i]);
+                counts[1] += Maths::Popcount64(A[i + 1] & B[i + 1]);
+                counts[2] += Maths::Popcount64(A[i + 2] & B[i + 2]);
+                counts[3] += Maths::Popcount64(A[i + 3] & B[i + 3]);
+            }
+            else
+            {
+                counts[0] += Maths::Popcount64(A[i]);
+                counts[1] += Maths::Popcount64(A[i + 1]);
+                counts[2] += Maths::Popcount64(A[i + 2]);
+                counts[3] += Maths::Popcount64(A[i + 3]);
+            }
+        }
+        result = counts[0] + counts[1] + counts[2] + counts[3];
+#endif
+        for (; i < wordsCount; i++)
+        {
+            result += Maths::Popcount64(B != NULL ? A[i] & B[i] : A[i]);
+        }
+        return result;
+    }
+
+    //returns the index of the first word at or after start that is not equal to skipValue (0 or ~0), or wordsCount
+    inline usize BitsetSkipWords(u64 *words, usize start, usize wordsCount, u64 skipValue)
+    {
+        usize i = start;
+#ifdef USE_AVX2
+        __m256i skip = _mm256_set1_epi64x((i64)skipValue);
+        for (; i + 4 <= wordsCount; i += 4)
+        {
+            __m256i value = _mm256_loadu_si256((__m256i*)(words + i));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(value, skip)) != -1)
+            {
+                break;
+            }
+        }
+#elif defined(USE_SSE)
+        __m128i skip = _mm_set1_epi32((i32)(u32)skipValue);
+        for (; i + 2 <= wordsCount; i += 2)
+        {
+            __m128i value = _mm_loadu_si128((__m128i*)(words + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(value, skip)) != 0xFFFF)
+            {
+                break;
+            }
+        }
+#endif
+        for (; i < wordsCount; i++)
+        {
+            if (words[i] != skipValue)
+            {
+                break;
+            }
+        }
+        return i;
+    }
+
+    //A dynamically sized array of bits packed into 64 bit words.
+    //Bits past length are always kept at 0, so whole word operations never need to mask the final word when reading.
+    struct bitset
+    {
+        IAllocator allocator;
+        u64 *words;
+        usize wordsCapacity;
+        usize length;
+
+        bitset()
+        {
+            allocator = IAllocator{};
+            words = NULL;
+            wordsCapacity = 0;
+            length = 0;
+        }
+        bitset(IAllocator myAllocator)
+        {
+            allocator = myAllocator;
+            words = NULL;
+            wordsCapacity = 0;
+            length = 0;
+        }
+        bitset(IAllocator myAllocator, usize bitsCount)
+        {
+            allocator = myAllocator;
+            words = NULL;
+            wordsCapacity = 0;
+            length = 0;
+            Resize(bitsCount);
+        }
+        void deinit()
+        {
+            if (words != NULL && allocator.allocFunction != NULL)
+            {
+                allocator.FREEPTR(words);
+            }
+            wordsCapacity = 0;
+            length = 0;
+        }
+
+        static inline usize WordsFor(usize bitsCount)
+        {
+            return (bitsCount + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+        }
+        inline usize WordsCount()
+        {
+            return WordsFor(length);
+        }
+        //zeroes the unused bits of the final word
+        inline void MaskFinalWord()
+        {
+            usize remainder = length % BITSET_WORD_BITS;
+            if (remainder != 0)
+            {
+                words[length / BITSET_WORD_BITS] &= (1ull << remainder) - 1;
+            }
+        }
+        //Changes the number of bits. Bits added by growing are unset
+        void Resize(usize bitsCount)
+        {
+            usize newWordsCount = WordsFor(bitsCount);
+            if (newWordsCount > wordsCapacity)
+            {
+                usize newCapacity = wordsCapacity == 0 ? 4 : wordsCapacity;
+                while (newCapacity < newWordsCount)
+                {
+                    newCapacity *= 2;
+                }
+                u64 *newWords = (u64*)allocator.Allocate(sizeof(u64) * newCapacity);
+                usize oldWordsCount = WordsCount();
+                if (words != NULL)
+                {
+                    memcpy(newWords, words, sizeof(u64) * oldWordsCount);
+                    allocator.Free(words);
+                }
+                memset(newWords + oldWordsCount, 0, sizeof(u64) * (newCapacity - oldWordsCount));
+                words = newWords;
+                wordsCapacity = newCapacity;
+            }
+            else if (bitsCount < length)
+            {
+                //clear everything that is being cut off so that growing again yields zeroes
+                usize oldWordsCount = WordsCount();
+                length = bitsCount;
+                if (bitsCount > 0)
+                {
+                    MaskFinalWord();
+                }
+                if (oldWordsCount > newWordsCount)
+                {
+                    memset(words + newWordsCount, 0, sizeof(u64) * (oldWordsCount - newWordsCount));
+                }
+            }
+            length = bitsCount;
+        }
+
+        inline bool Get(usize index)
+        {
+            assert(index < length);
+            return (words[index / BITSET_WORD_BITS] >> (index % BITSET_WORD_BITS)) & 1;
+        }
+        inline void Set(usize index)
+        {
+            assert(index < length);
+            words[index / BITSET_WORD_BITS] |= 1ull << (index % BITSET_WORD_BITS);
+        }
+        inline void Unset(usize index)
+        {
+            assert(index < length);
+            words[index / BITSET_WORD_BITS] &= ~(1ull << (index % BITSET_WORD_BITS));
+        }
+        inline void SetTo(usize index, bool value)
+        {
+            assert(index < length);
+            u64 mask = 1ull << (index % BITSET_WORD_BITS);
+            u64 *word = &words[index / BITSET_WORD_BITS];
+            *word = (*word & ~mask) | (((u64)0 - (u64)value) & mask);
+        }
+        inline void Toggle(usize index)
+        {
+            assert(index < length);
+            words[index / BITSET_WORD_BITS] ^= 1ull << (index % BITSET_WORD_BITS);
+        }
+        void SetAll()
+        {
+            if (length == 0)
+            {
+                return;
+            }
+            memset(words, 0xFF, sizeof(u64) * WordsCount());
+            MaskFinalWord();
+        }
+        void UnsetAll()
+        {
+            if (length == 0)
+            {
+                return;
+            }
+            memset(words, 0, sizeof(u64) * WordsCount());
+        }
+
+        //The following operate up to the shorter of the two bitsets.
+        //And additionally clears any bits of this bitset past the end of other
+        void And(bitset *other)
+        {
+            usize thisWords = WordsCount();
+            usize otherWords = other->WordsCount();
+            usize shared = thisWords < otherWords ? thisWords : otherWords;
+            BitsetApply<BitsetAndOp>(words, other->words, shared);
+            if (thisWords > shared)
+            {
+                memset(words + shared, 0, sizeof(u64) * (thisWords - shared));
+            }
+        }
+        void Or(bitset *other)
+        {
+            usize thisWords = WordsCount();
+            usize otherWords = other->WordsCount();
+            BitsetApply<BitsetOrOp>(words, other->words, thisWords < otherWords ? thisWords : otherWords);
+            if (length > 0)
+            {
+                MaskFinalWord();
+            }
+        }
+        void Xor(bitset *other)
+        {
+            usize thisWords = WordsCount();
+            usize otherWords = other->WordsCount();
+            BitsetApply<BitsetXorOp>(words, other->words, thisWords < otherWords ? thisWords : otherWords);
+            if (length > 0)
+            {
+                MaskFinalWord();
+            }
+        }
+        //clears every bit that is set in other
+        void AndNot(bitset *other)
+        {
+            usize thisWords = WordsCount();
+            usize otherWords = other->WordsCount();
+            BitsetApply<BitsetAndNotOp>(words, other->words, thisWords < otherWords ? thisWords : otherWords);
+        }
+
+        inline usize Popcount()
+        {
+            return BitsetPopcount(words, NULL, WordsCount());
+        }
+        //counts the bits set in both bitsets without modifying either
+        inline usize AndPopcount(bitset *other)
+        {
+            usize thisWords = WordsCount();
+            usize otherWords = other->WordsCount();
+            return BitsetPopcount(words, other->words, thisWords < otherWords ? thisWords : otherWords);
+        }
+        inline bool Any()
+        {
+            return BitsetSkipWords(words, 0, WordsCount(), 0) < WordsCount();
+        }
+        inline bool None()
+        {
+            return !Any();
+        }
+
+        //index of the first set bit at or after start
+        option<usize> FindFirstSet(usize start = 0)
+        {
+            if (start >= length)
+            {
+                return option<usize>();
+            }
+            usize wordsCount = WordsCount();
+            usize wordIndex = start / BITSET_WORD_BITS;
+            u64 word = words[wordIndex] & (~0ull << (start % BITSET_WORD_BITS));
+            if (word == 0)
+            {
+                wordIndex = BitsetSkipWords(words, wordIndex + 1, wordsCount, 0);
+                if (wordIndex >= wordsCount)
+                {
+                    return option<usize>();
+                }
+                word = words[wordIndex];
+            }
+            return option<usize>(wordIndex * BITSET_WORD_BITS + Maths::CountTrailingZeros64(word));
+        }
+        //index of the first unset bit at or after start
+        option<usize> FindFirstUnset(usize start = 0)
+        {
+            if (start >= length)
+            {
+                return option<usize>();
+            }
+            usize wordsCount = WordsCount();
+            usize wordIndex = start / BITSET_WORD_BITS;
+            u64 word = ~words[wordIndex] & (~0ull << (start % BITSET_WORD_BITS));
+            if (word == 0)
+            {
+                wordIndex = BitsetSkipWords(words, wordIndex + 1, wordsCount, ~0ull);
+                if (wordIndex >= wordsCount)
+                {
+                    return option<usize>();
+                }
+                word = ~words[wordIndex];
+            }
+            usize result = wordIndex * BITSET_WORD_BITS + Maths::CountTrailingZeros64(word);
+            if (result >= length)
+            {
+                return option<usize>();
+            }
+            return option<usize>(result);
+        }
+
+        //Iterates the indices of set bits in ascending order, one word at a time
+        struct Iterator
+        {
+            bitset *set;
+            usize wordIndex;
+            u64 currentWord;
+            bool completed;
+
+            Iterator(bitset *set)
+            {
+                this->set = set;
+                wordIndex = 0;
+                currentWord = set->length > 0 ? set->words[0] : 0;
+                completed = false;
+            }
+            usize Next()
+            {
+                usize wordsCount = set->WordsCount();
+                while (currentWord == 0)
+                {
+                    wordIndex = BitsetSkipWords(set->words, wordIndex + 1, wordsCount, 0);
+                    if (wordIndex >= wordsCount)
+                    {
+                        completed = true;
+                        return set->length;
+                    }
+                    currentWord = set->words[wordIndex];
+                }
+                usize result = wordIndex * BITSET_WORD_BITS + Maths::CountTrailingZeros64(currentWord);
+                //clear the lowest set bit
+                currentWord &= currentWord - 1;
+                return result;
+            }
+        };
+        inline Iterator GetIterator()
+        {
+            return Iterator(this);
+        }
+
+        bitset Clone(IAllocator newAllocator)
+        {
+            bitset result = bitset(newAllocator, length);
+            if (length > 0)
+            {
+                memcpy(result.words, words, sizeof(u64) * WordsCount());
+            }
+            return result;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,817 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "sorting.hpp"
+#include <assert.h>
+
+#ifndef foreach
+#define foreach(instance, iterator) for (auto instance = iterator.Next(); !iterator.completed; instance = iterator.Next())
+#endif
+
+//Target size of the keys + values/children of each node in bytes.
+//Nodes are searched with a binary search, so wider nodes mostly trade insertion shifting for a shallower tree.
+#ifndef BTREE_NODE_BYTES
+#define BTREE_NODE_BYTES 512
+#endif
+#define BTREE_MAX_DEPTH 32
+
+namespace collections
+{
+    //An ordered map implemented as a B+ tree. All key/value pairs live in the leaves, which are linked to each other
+    //so that ordered iteration and range scans walk contiguous arrays instead of chasing a pointer per element.
+    //Keys and values of a leaf are kept in separate arrays so that searching a node only touches keys.
+    //Pointers returned by Add/Get are invalidated by any later Add or Remove.
+    template<typename K, typename V, typename Less = OperatorLess<K>>
+    struct btreemap
+    {
+        static constexpr usize LeafCapacity = BTREE_NODE_BYTES / (sizeof(K) + sizeof(V)) < 3 ? 3 : BTREE_NODE_BYTES / (sizeof(K) + sizeof(V));
+        static constexpr usize InternalCapacity = BTREE_NODE_BYTES / (sizeof(K) + sizeof(void*)) < 3 ? 3 : BTREE_NODE_BYTES / (sizeof(K) + sizeof(void*));
+        static constexpr usize MinLeafCount = LeafCapacity / 2;
+        static constexpr usize MinInternalCount = InternalCapacity / 2;
+
+        struct Node
+        {
+            u32 count;
+            bool isLeaf;
+        };
+        struct LeafNode
+        {
+            Node header;
+            LeafNode *prev;
+            LeafNode *next;
+            K keys[LeafCapacity];
+            V values[LeafCapacity];
+        };
+        //children[i] holds keys that are < keys[i] and >= keys[i - 1]
+        struct InternalNode
+        {
+            Node header;
+            K keys[InternalCapacity];
+            Node *children[InternalCapacity + 1];
+        };
+        struct KeyValue
+        {
+            K *key;
+            V *value;
+        };
+        struct Iterator
+        {
+            LeafNode *leaf;
+            usize index;
+            LeafNode *endLeaf;
+            usize endIndex;
+            bool completed;
+
+            Iterator()
+            {
+                leaf = NULL;
+                index = 0;
+                endLeaf = NULL;
+                endIndex = 0;
+                completed = false;
+            }
+            Iterator(LeafNode *leaf, usize index, LeafNode *endLeaf, usize endIndex)
+            {
+                this->leaf = leaf;
+                this->index = index;
+                this->endLeaf = endLeaf;
+                this->endIndex = endIndex;
+                completed = false;
+            }
+            KeyValue Next()
+            {
+                KeyValue result;
+                if (completed || leaf == NULL || (leaf == endLeaf && index == endIndex))
+                {
+                    completed = true;
+                    result.key = NULL;
+                    result.value = NULL;
+                    return result;
+                }
+                result.key = &leaf->keys[index];
+                result.value = &leaf->values[index];
+                index++;
+                if (index >= leaf->header.count)
+                {
+                    leaf = leaf->next;
+                    index = 0;
+                }
+                return result;
+            }
+        };
+
+        IAllocator allocator;
+        Node *root;
+        LeafNode *firstLeaf;
+        LeafNode *lastLeaf;
+        Less less;
+        usize count;
+        usize depth;
+
+        btreemap()
+        {
+            allocator = IAllocator{};
+            root = NULL;
+            firstLeaf = NULL;
+            lastLeaf = NULL;
+            less = Less();
+            count = 0;
+            depth = 0;
+        }
+        btreemap(IAllocator myAllocator)
+        {
+            allocator = myAllocator;
+            root = NULL;
+            firstLeaf = NULL;
+            lastLeaf = NULL;
+            less = Less();
+            count = 0;
+            depth = 0;
+        }
+        btreemap(IAllocator myAllocator, Less comparator)
+        {
+            allocator = myAllocator;
+            root = NULL;
+            firstLeaf = NULL;
+            lastLeaf = NULL;
+            less = comparator;
+            count = 0;
+            depth = 0;
+        }
+        void deinit()
+        {
+            if (root != NULL)
+            {
+                FreeNode(root);
+            }
+            root = NULL;
+            firstLeaf = NULL;
+            lastLeaf = NULL;
+            count = 0;
+            depth = 0;
+        }
+        inline void Clear()
+        {
+            deinit();
+        }
+        void FreeNode(Node *node)
+        {
+            if (!node->isLeaf)
+            {
+                InternalNode *internal = (InternalNode*)node;
+                for (usize i = 0; i <= internal->header.count; i++)
+                {
+                    FreeNode(internal->children[i]);
+                }
+            }
+            allocator.Free(node);
+        }
+
+        //first index whose key is not less than key
+        inline usize NodeLowerBound(K *keys, usize keysCount, K &key)
+        {
+            usize low = 0;
+            usize high = keysCount;
+            while (low < high)
+            {
+                usize mid = (low + high) / 2;
+                if (less(keys[mid], key))
+                {
+                    low = mid + 1;
+                }
+                else high = mid;
+            }
+            return low;
+        }
+        //first index whose key is greater than key
+        inline usize NodeUpperBound(K *keys, usize keysCount, K &key)
+        {
+            usize low = 0;
+            usize high = keysCount;
+            while (low < high)
+            {
+                usize mid = (low + high) / 2;
+                if (less(key, keys[mid]))
+                {
+                    high = mid;
+                }
+                else low = mid + 1;
+            }
+            return low;
+        }
+        LeafNode *FindLeaf(K &key)
+        {
+            Node *node = root;
+            while (!node->isLeaf)
+            {
+                InternalNode *internal = (InternalNode*)node;
+                node = internal->children[NodeUpperBound(internal->keys, internal->header.count, key)];
+            }
+            return (LeafNode*)node;
+        }
+        LeafNode *NewLeaf()
+        {
+            LeafNode *leaf = (LeafNode*)allocator.Allocate(sizeof(LeafNode));
+            leaf->header.count = 0;
+            leaf->header.isLeaf = true;
+            leaf->prev = NULL;
+            leaf->next = NULL;
+            return leaf;
+        }
+        InternalNode *NewInternal()
+        {
+            InternalNode *internal = (InternalNode*)allocator.Allocate(sizeof(InternalNode));
+            internal->header.count = 0;
+            internal->header.isLeaf = false;
+            return internal;
+        }
+
+        V *Get(K key)
+        {
+            if (root == NULL)
+            {
+                return NULL;
+            }
+            LeafNode *leaf = FindLeaf(key);
+            usize index = NodeLowerBound(leaf->keys, leaf->header.count, key);
+            if (index < leaf->header.count && !less(key, leaf->keys[index]))
+            {
+                return &leaf->values[index];
+            }
+            return NULL;
+        }
+        V GetCopyOr(K key, V valueOnNotFound)
+        {
+            V *result = Get(key);
+            if (result == NULL)
+            {
+                return valueOnNotFound;
+            }
+            return *result;
+        }
+        inline bool Contains(K key)
+        {
+            return Get(key) != NULL;
+        }
+
+        //Adds a key/value pair, replacing the value if the key already exists
+        V *Add(K key, V value)
+        {
+            if (root == NULL)
+            {
+                LeafNode *leaf = NewLeaf();
+                leaf->keys[0] = key;
+                leaf->values[0] = value;
+                leaf->header.count = 1;
+                root = &leaf->header;
+                firstLeaf = leaf;
+                lastLeaf = leaf;
+                count = 1;
+                depth = 1;
+                return &leaf->values[0];
+            }
+
+            InternalNode *parents[BTREE_MAX_DEPTH];
+            usize slots[BTREE_MAX_DEPTH];
+            usize parentsCount = 0;
+
+            Node *node = root;
+            while (!node->isLeaf)
+            {
+                InternalNode *internal = (InternalNode*)node;
+                usize slot = NodeUpperBound(internal->keys, internal->header.count, key);
+                parents[parentsCount] = internal;
+                slots[parentsCount] = slot;
+                parentsCount++;
+                node = internal->children[slot];
+            }
+            LeafNode *leaf = (LeafNode*)node;
+            usize index = NodeLowerBound(leaf->keys, leaf->header.count, key);
+            if (index < leaf->header.count && !less(key, leaf->keys[index]))
+            {
+                leaf->values[index] = value;
+                return &leaf->values[index];
+            }
+            count++;
+
+            if (leaf->header.count < LeafCapacity)
+            {
+                InsertIntoLeaf(leaf, index, key, value);
+                return &leaf->values[index];
+            }
+
+            //split the full leaf, moving the upper half into a new leaf
+            LeafNode *right = NewLeaf();
+            usize leftCount = (LeafCapacity + 1) / 2;
+            V *result;
+            if (index < leftCount)
+            {
+                //new item goes into the left half, so one less existing item stays on the left
+                MoveLeafItems(leaf, leftCount - 1, right, 0, LeafCapacity - (leftCount - 1));
+                right->header.count = LeafCapacity - (leftCount - 1);
+                leaf->header.count = leftCount - 1;
+                InsertIntoLeaf(leaf, index, key, value);
+                result = &leaf->values[index];
+            }
+            else
+            {
+                MoveLeafItems(leaf, leftCount, right, 0, LeafCapacity - leftCount);
+                right->header.count = LeafCapacity - leftCount;
+                leaf->header.count = leftCount;
+                InsertIntoLeaf(right, index - leftCount, key, value);
+                result = &right->values[index - leftCount];
+            }
+            right->next = leaf->next;
+            right->prev = leaf;
+            if (leaf->next != NULL)
+            {
+                leaf->next->prev = right;
+            }
+            else lastLeaf = right;
+            leaf->next = right;
+
+            K separator = right->keys[0];
+            Node *newChild = &right->header;
+            //propagate the split up the tree
+            while (parentsCount > 0)
+            {
+                parentsCount--;
+                InternalNode *parent = parents[parentsCount];
+                usize slot = slots[parentsCount];
+                if (parent->header.count < InternalCapacity)
+                {
+                    InsertIntoInternal(parent, slot, separator, newChild);
+                    return result;
+                }
+
+                K tempKeys[InternalCapacity + 1];
+                Node *tempChildren[InternalCapacity + 2];
+                for (usize i = 0; i < slot; i++)
+                {
+                    tempKeys[i] = parent->keys[i];
+                }
+                tempKeys[slot] = separator;
+                for (usize i = slot; i < InternalCapacity; i++)
+                {
+                    tempKeys[i + 1] = parent->keys[i];
+                }
+                for (usize i = 0; i <= slot; i++)
+                {
+                    tempChildren[i] = parent->children[i];
+                }
+                tempChildren[slot + 1] = newChild;
+                for (usize i = slot + 1; i <= InternalCapacity; i++)
+                {
+                    tempChildren[i + 1] = parent->children[i];
+                }
+
+                usize mid = (InternalCapacity + 1) / 2;
+                InternalNode *rightInternal = NewInternal();
+                for (usize i = 0; i < mid; i++)
+                {
+                    parent->keys[i] = tempKeys[i];
+                    parent->children[i] = tempChildren[i];
+                }
+                parent->children[mid] = tempChildren[mid];
+                parent->header.count = (u32)mid;
+
+                usize rightCount = InternalCapacity - mid;
+                for (usize i = 0; i < rightCount; i++)
+                {
+                    rightInternal->keys[i] = tempKeys[mid + 1 + i];
+                    rightInternal->children[i] = tempChildren[mid + 1 + i];
+                }
+                rightInternal->children[rightCount] = tempChildren[InternalCapacity + 1];
+                rightInternal->header.count = (u32)rightCount;
+
+                separator = tempKeys[mid];
+                newChild = &rightInternal->header;
+            }
+
+            //the root itself was split
+            InternalNode *newRoot = NewInternal();
+            newRoot->keys[0] = separator;
+            newRoot->children[0] = root;
+            newRoot->children[1] = newChild;
+            newRoot->header.count = 1;
+            root = &newRoot->header;
+            depth++;
+            assert(depth <= BTREE_MAX_DEPTH);
+            return result;
+        }
+
+        inline void InsertIntoLeaf(LeafNode *leaf, usize index, K &key, V &value)
+        {
+            for (usize i = leaf->header.count; i > index; i--)
+            {
+                leaf->keys[i] = leaf->keys[i - 1];
+                leaf->values[i] = leaf->values[i - 1];
+            }
+            leaf->keys[index] = key;
+            leaf->values[index] = value;
+            leaf->header.count++;
+        }
+        inline void InsertIntoInternal(InternalNode *node, usize slot, K &key, Node *rightChild)
+        {
+            for (usize i = node->header.count; i > slot; i--)
+            {
+                node->keys[i] = node->keys[i - 1];
+                node->children[i + 1] = node->children[i];
+            }
+            node->keys[slot] = key;
+            node->children[slot + 1] = rightChild;
+            node->header.count++;
+        }
+        inline void MoveLeafItems(LeafNode *from, usize fromIndex, LeafNode *to, usize toIndex, usize itemsCount)
+        {
+            for (usize i = 0; i < itemsCount; i++)
+            {
+                to->keys[toIndex + i] = from->keys[fromIndex + i];
+                to->values[toIndex + i] = from->values[fromIndex + i];
+            }
+        }
+        //removes keys[keyIndex] and children[keyIndex + 1]
+        inline void RemoveFromInternal(InternalNode *node, usize keyIndex)
+        {
+            for (usize i = keyIndex; i + 1 < node->header.count; i++)
+            {
+                node->keys[i] = node->keys[i + 1];
+                node->children[i + 1] = node->children[i + 2];
+            }
+            node->header.count--;
+        }
+
+        bool Remove(K key)
+        {
+            if (root == NULL)
+            {
+                return false;
+            }
+            InternalNode *parents[BTREE_MAX_DEPTH];
+            usize slots[BTREE_MAX_DEPTH];
+            usize parentsCount = 0;
+
+            Node *node = root;
+            while (!node->isLeaf)
+            {
+                InternalNode *internal = (InternalNode*)node;
+                usize slot = NodeUpperBound(internal->keys, internal->header.count, key);
+                parents[parentsCount] = internal;
+                slots[parentsCount] = slot;
+                parentsCount++;
+                node = internal->children[slot];
+            }
+            LeafNode *leaf = (LeafNode*)node;
+            usize index = NodeLowerBound(leaf->keys, leaf->header.count, key);
+            if (index >= leaf->header.count || less(key, leaf->keys[index]))
+            {
+                return false;
+            }
+            for (usize i = index + 1; i < leaf->header.count; i++)
+            {
+                leaf->keys[i - 1] = leaf->keys[i];
+                leaf->values[i - 1] = leaf->values[i];
+            }
+            leaf->header.count--;
+            count--;
+
+            if (parentsCount == 0)
+            {
+                if (leaf->header.count == 0)
+                {
+                    allocator.Free(leaf);
+                    root = NULL;
+                    firstLeaf = NULL;
+                    lastLeaf = NULL;
+                    depth = 0;
+                }
+                return true;
+            }
+            if (leaf->header.count >= MinLeafCount)
+            {
+                return true;
+            }
+
+            InternalNode *parent = parents[parentsCount - 1];
+            usize slot = slots[parentsCount - 1];
+            LeafNode *left = slot > 0 ? (LeafNode*)parent->children[slot - 1] : NULL;
+            LeafNode *right = slot < parent->header.count ? (LeafNode*)parent->children[slot + 1] : NULL;
+            if (left != NULL && left->header.count > MinLeafCount)
+            {
+                InsertIntoLeaf(leaf, 0, left->keys[left->header.count - 1], left->values[left->header.count - 1]);
+                left->header.count--;
+                parent->keys[slot - 1] = leaf->keys[0];
+                return true;
+            }
+            if (right != NULL && right->header.count > MinLeafCount)
+            {
+                leaf->keys[leaf->header.count] = right->keys[0];
+                leaf->values[leaf->header.count] = right->values[0];
+                leaf->header.count++;
+                MoveLeafItems(right, 1, right, 0, right->header.count - 1);
+                right->header.count--;
+                parent->keys[slot] = right->keys[0];
+                return true;
+            }
+            //neither sibling can spare an item, merge with one of them
+            if (left != NULL)
+            {
+                MergeLeaves(left, leaf);
+                RemoveFromInternal(parent, slot - 1);
+            }
+            else
+            {
+                MergeLeaves(leaf, right);
+                RemoveFromInternal(parent, slot);
+            }
+
+            //fix up internal nodes that fell below their minimum size
+            usize level = parentsCount - 1;
+            while (true)
+            {
+                InternalNode *current = parents[level];
+                if (level == 0)
+                {
+                    if (current->header.count == 0)
+                    {
+                        root = current->children[0];
+                        allocator.Free(current);
+                        depth--;
+                    }
+                    break;
+                }
+                if (current->header.count >= MinInternalCount)
+                {
+                    break;
+                }
+                InternalNode *currentParent = parents[level - 1];
+                usize currentSlot = slots[level - 1];
+                InternalNode *leftInternal = currentSlot > 0 ? (InternalNode*)currentParent->children[currentSlot - 1] : NULL;
+                InternalNode *rightInternal = currentSlot < currentParent->header.count ? (InternalNode*)currentParent->children[currentSlot + 1] : NULL;
+
+                if (leftInternal != NULL && leftInternal->header.count > MinInternalCount)
+                {
+                    //rotate right through the parent
+                    current->children[current->header.count + 1] = current->children[current->header.count];
+                    for (usize i = current->header.count; i > 0; i--)
+                    {
+                        current->keys[i] = current->keys[i - 1];
+                        current->children[i] = current->children[i - 1];
+                    }
+                    current->keys[0] = currentParent->keys[currentSlot - 1];
+                    current->children[0] = leftInternal->children[leftInternal->header.count];
+                    current->header.count++;
+                    currentParent->keys[currentSlot - 1] = leftInternal->keys[leftInternal->header.count - 1];
+                    leftInternal->header.count--;
+                    break;
+                }
+                if (rightInternal != NULL && rightInternal->header.count > MinInternalCount)
+                {
+                    //rotate left through the parent
+                    current->keys[current->header.count] = currentParent->keys[currentSlot];
+                    current->children[current->header.count + 1] = rightInternal->children[0];
+                    current->header.count++;
+                    currentParent->keys[currentSlot] = rightInternal->keys[0];
+                    for (usize i = 0; i + 1 < rightInternal->header.count; i++)
+                    {
+                        rightInternal->keys[i] = rightInternal->keys[i + 1];
+                        rightInternal->children[i] = rightInternal->children[i + 1];
+                    }
+                    rightInternal->children[rightInternal->header.count - 1] = rightInternal->children[rightInternal->header.count];
+                    rightInternal->header.count--;
+                    break;
+                }
+                if (leftInternal != NULL)
+                {
+                    MergeInternals(leftInternal, currentParent->keys[currentSlot - 1], current);
+                    RemoveFromInternal(currentParent, currentSlot - 1);
+                }
+                else
+                {
+                    MergeInternals(current, currentParent->keys[currentSlot], rightInternal);
+                    RemoveFromInternal(currentParent, currentSlot);
+                }
+                level--;
+            }
+            return true;
+        }
+        //moves everything in right into left and frees right
+        void MergeLeaves(LeafNode *left, LeafNode *right)
+        {
+            MoveLeafItems(right, 0, left, left->header.count, right->header.count);
+            left->header.count += right->header.count;
+            left->next = right->next;
+            if (right->next != NULL)
+            {
+                right->next->prev = left;
+            }
+            else lastLeaf = left;
+            allocator.Free(right);
+        }
+        void MergeInternals(InternalNode *left, K &separator, InternalNode *right)
+        {
+            usize leftCount = left->header.count;
+            left->keys[leftCount] = separator;
+            for (usize i = 0; i < right->header.count; i++)
+            {
+                left->keys[leftCount + 1 + i] = right->keys[i];
+                left->children[leftCount + 1 + i] = right->children[i];
+            }
+            left->children[leftCount + 1 + right->header.count] = right->children[right->header.count];
+            left->header.count += 1 + right->header.count;
+            allocator.Free(right);
+        }
+
+        KeyValue First()
+        {
+            KeyValue result;
+            result.key = firstLeaf != NULL ? &firstLeaf->keys[0] : NULL;
+            result.value = firstLeaf != NULL ? &firstLeaf->values[0] : NULL;
+            return result;
+        }
+        KeyValue Last()
+        {
+            KeyValue result;
+            result.key = lastLeaf != NULL ? &lastLeaf->keys[lastLeaf->header.count - 1] : NULL;
+            result.value = lastLeaf != NULL ? &lastLeaf->values[lastLeaf->header.count - 1] : NULL;
+            return result;
+        }
+
+        //positions are normalized so that they never point past the end of a leaf, which lets iterators compare them directly
+        inline void NormalizePosition(LeafNode **leaf, usize *index)
+        {
+            if (*leaf != NULL && *index >= (*leaf)->header.count)
+            {
+                *leaf = (*leaf)->next;
+                *index = 0;
+            }
+        }
+        void LowerBoundPosition(K &key, LeafNode **leaf, usize *index)
+        {
+            if (root == NULL)
+            {
+                *leaf = NULL;
+                *index = 0;
+                return;
+            }
+            *leaf = FindLeaf(key);
+            *index = NodeLowerBound((*leaf)->keys, (*leaf)->header.count, key);
+            NormalizePosition(leaf, index);
+        }
+        void UpperBoundPosition(K &key, LeafNode **leaf, usize *index)
+        {
+            if (root == NULL)
+            {
+                *leaf = NULL;
+                *index = 0;
+                return;
+            }
+            *leaf = FindLeaf(key);
+            *index = NodeUpperBound((*leaf)->keys, (*leaf)->header.count, key);
+            NormalizePosition(leaf, index);
+        }
+
+        //Iterates every pair in key order
+        inline Iterator GetIterator()
+        {
+            return Iterator(firstLeaf, 0, NULL, 0);
+        }
+        //Iterates from the first key that is not less than key to the end of the map
+        Iterator LowerBound(K key)
+        {
+            LeafNode *leaf;
+            usize index;
+            LowerBoundPosition(key, &leaf, &index);
+            return Iterator(leaf, index, NULL, 0);
+        }
+        //Iterates from the first key that is greater than key to the end of the map
+        Iterator UpperBound(K key)
+        {
+            LeafNode *leaf;
+            usize index;
+            UpperBoundPosition(key, &leaf, &index);
+            return Iterator(leaf, index, NULL, 0);
+        }
+        //Iterates every key in [min, max)
+        Iterator Range(K min, K max)
+        {
+            LeafNode *leaf;
+            usize index;
+            LeafNode *endLeaf;
+            usize endIndex;
+            LowerBoundPosition(min, &leaf, &index);
+            if (!less(min, max))
+            {
+                return Iterator(leaf, index, leaf, index);
+            }
+            LowerBoundPosition(max, &endLeaf, &endIndex);
+            return Iterator(leaf, index, endLeaf, endIndex);
+        }
+        //Iterates every key in [min, max]
+        Iterator RangeInclusive(K min, K max)
+        {
+            LeafNode *leaf;
+            usize index;
+            LeafNode *endLeaf;
+            usize endIndex;
+            LowerBoundPosition(min, &leaf, &index);
+            if (less(max, min))
+            {
+                return Iterator(leaf, index, leaf, index);
+            }
+            UpperBoundPosition(max, &endLeaf, &endIndex);
+            return Iterator(leaf, index, endLeaf, endIndex);
+        }
+    };
+
+    struct BTreeNoValue
+    {
+    };
+
+    //An ordered set, stored as a btreemap with an empty value type
+    template<typename K, typename Less = OperatorLess<K>>
+    struct btreeset
+    {
+        typedef btreemap<K, BTreeNoValue, Less> MapType;
+
+        MapType map;
+
+        struct Iterator
+        {
+            typename MapType::Iterator mapIterator;
+            bool completed;
+
+            Iterator(typename MapType::Iterator mapIterator)
+            {
+                this->mapIterator = mapIterator;
+                completed = false;
+            }
+            K *Next()
+            {
+                K *result = mapIterator.Next().key;
+                completed = mapIterator.completed;
+                return result;
+            }
+        };
+
+        btreeset()
+        {
+            map = MapType();
+        }
+        btreeset(IAllocator myAllocator)
+        {
+            map = MapType(myAllocator);
+        }
+        btreeset(IAllocator myAllocator, Less comparator)
+        {
+            map = MapType(myAllocator, comparator);
+        }
+        inline void deinit()
+        {
+            map.deinit();
+        }
+        inline void Clear()
+        {
+            map.Clear();
+        }
+        inline usize Count()
+        {
+            return map.count;
+        }
+        //returns true if the key was not already in the set
+        inline bool Add(K key)
+        {
+            usize previousCount = map.count;
+            map.Add(key, BTreeNoValue());
+            return map.count != previousCount;
+        }
+        inline bool Remove(K key)
+        {
+            return map.Remove(key);
+        }
+        inline bool Contains(K key)
+        {
+            return map.Contains(key);
+        }
+        inline Iterator GetIterator()
+        {
+            return Iterator(map.GetIterator());
+        }
+        inline Iterator LowerBound(K key)
+        {
+            return Iterator(map.LowerBound(key));
+        }
+        inline Iterator UpperBound(K key)
+        {
+            return Iterator(map.UpperBound(key));
+        }
+        inline Iterator Range(K min, K max)
+        {
+            return Iterator(map.Range(min, max));
+        }
+        inline Iterator RangeInclusive(K min, K max)
+        {
+            return Iterator(map.RangeInclusive(min, max));
+        }
+    };
+}
\ No newline at end of file
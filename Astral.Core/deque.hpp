@@ -0,0 +1,251 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include <string.h>
+#include <assert.h>
+
+#ifndef foreach
+#define foreach(instance, iterator) for (auto instance = iterator.Next(); !iterator.completed; instance = iterator.Next())
+#endif
+
+#define DEQUE_DEFAULT_BLOCK_SIZE(T) (sizeof(T) <= 256 ? 4096 / sizeof(T) : 16)
+
+namespace collections
+{
+    //A double ended queue stored as fixed size blocks of items, found through a central array of block pointers (the map).
+    //Items never move once added, so pointers returned by PushBack/PushFront/Get stay valid until that item is popped,
+    //unlike vector and queue which move every item on growth. Growing only reallocates the map of block pointers.
+    template<typename T, usize BlockSize = DEQUE_DEFAULT_BLOCK_SIZE(T)>
+    struct deque
+    {
+        IAllocator allocator;
+        T **blocks;
+        usize blocksCapacity;
+        //index of the first used block within blocks
+        usize firstBlock;
+        usize blocksCount;
+        //index of the first item within the first used block
+        usize firstIndex;
+        usize count;
+        //the most recently emptied block is kept around so that usage hovering at a block boundary does not allocate every push
+        T *spareBlock;
+
+        deque()
+        {
+            allocator = IAllocator{};
+            blocks = NULL;
+            blocksCapacity = 0;
+            firstBlock = 0;
+            blocksCount = 0;
+            firstIndex = 0;
+            count = 0;
+            spareBlock = NULL;
+        }
+        deque(IAllocator myAllocator)
+        {
+            allocator = myAllocator;
+            blocks = NULL;
+            blocksCapacity = 0;
+            firstBlock = 0;
+            blocksCount = 0;
+            firstIndex = 0;
+            count = 0;
+            spareBlock = NULL;
+        }
+        void deinit()
+        {
+            Clear();
+            if (spareBlock != NULL)
+            {
+                allocator.FREEPTR(spareBlock);
+            }
+            if (blocks != NULL)
+            {
+                allocator.FREEPTR(blocks);
+            }
+            blocksCapacity = 0;
+            firstBlock = 0;
+        }
+        void Clear()
+        {
+            for (usize i = 0; i < blocksCount; i++)
+            {
+                ReleaseBlock(blocks[firstBlock + i]);
+            }
+            blocksCount = 0;
+            firstBlock = blocksCapacity / 2;
+            firstIndex = 0;
+            count = 0;
+        }
+
+        inline T *NewBlock()
+        {
+            if (spareBlock != NULL)
+            {
+                T *result = spareBlock;
+                spareBlock = NULL;
+                return result;
+            }
+            return (T*)allocator.Allocate(sizeof(T) * BlockSize);
+        }
+        inline void ReleaseBlock(T *block)
+        {
+            if (spareBlock == NULL)
+            {
+                spareBlock = block;
+            }
+            else allocator.Free(block);
+        }
+        //makes room in the map for one more block on the front or back
+        void ReserveMapSlot(bool atFront)
+        {
+            bool hasRoom = atFront ? firstBlock > 0 : firstBlock + blocksCount < blocksCapacity;
+            if (hasRoom)
+            {
+                return;
+            }
+            if (blocks != NULL && blocksCount * 2 < blocksCapacity)
+            {
+                //plenty of space on the other side, recenter instead of growing
+                usize newFirst = (blocksCapacity - blocksCount) / 2;
+                memmove(blocks + newFirst, blocks + firstBlock, sizeof(T*) * blocksCount);
+                firstBlock = newFirst;
+                return;
+            }
+            usize newCapacity = blocksCapacity == 0 ? 8 : blocksCapacity * 2;
+            T **newBlocks = (T**)allocator.Allocate(sizeof(T*) * newCapacity);
+            usize newFirst = (newCapacity - blocksCount) / 2;
+            if (blocks != NULL)
+            {
+                memcpy(newBlocks + newFirst, blocks + firstBlock, sizeof(T*) * blocksCount);
+                allocator.Free(blocks);
+            }
+            blocks = newBlocks;
+            blocksCapacity = newCapacity;
+            firstBlock = newFirst;
+        }
+
+        T *PushBack(T item)
+        {
+            usize end = firstIndex + count;
+            if (end == blocksCount * BlockSize)
+            {
+                ReserveMapSlot(false);
+                blocks[firstBlock + blocksCount] = NewBlock();
+                blocksCount++;
+            }
+            T *result = &blocks[firstBlock + end / BlockSize][end % BlockSize];
+            *result = item;
+            count++;
+            return result;
+        }
+        T *PushFront(T item)
+        {
+            if (firstIndex == 0)
+            {
+                ReserveMapSlot(true);
+                if (blocksCount > 0)
+                {
+                    firstBlock--;
+                }
+                blocks[firstBlock] = NewBlock();
+                blocksCount++;
+                firstIndex = BlockSize;
+            }
+            firstIndex--;
+            T *result = &blocks[firstBlock][firstIndex];
+            *result = item;
+            count++;
+            return result;
+        }
+        T PopBack()
+        {
+            if (count == 0)
+            {
+                return T();
+            }
+            count--;
+            usize end = firstIndex + count;
+            T result = blocks[firstBlock + end / BlockSize][end % BlockSize];
+            if (count == 0)
+            {
+                Clear();
+            }
+            else if (end % BlockSize == 0)
+            {
+                //the final block is now empty
+                blocksCount--;
+                ReleaseBlock(blocks[firstBlock + blocksCount]);
+            }
+            return result;
+        }
+        T PopFront()
+        {
+            if (count == 0)
+            {
+                return T();
+            }
+            T result = blocks[firstBlock][firstIndex];
+            firstIndex++;
+            count--;
+            if (count == 0)
+            {
+                Clear();
+            }
+            else if (firstIndex == BlockSize)
+            {
+                ReleaseBlock(blocks[firstBlock]);
+                firstBlock++;
+                blocksCount--;
+                firstIndex = 0;
+            }
+            return result;
+        }
+
+        inline T *Get(usize index)
+        {
+            assert(index < count);
+            usize position = firstIndex + index;
+            return &blocks[firstBlock + position / BlockSize][position % BlockSize];
+        }
+        inline T& operator[](usize index)
+        {
+            return *Get(index);
+        }
+        inline T *PeekFront()
+        {
+            return count == 0 ? NULL : Get(0);
+        }
+        inline T *PeekBack()
+        {
+            return count == 0 ? NULL : Get(count - 1);
+        }
+
+        struct Iterator
+        {
+            deque<T, BlockSize> *instance;
+            usize index;
+            bool completed;
+
+            Iterator(deque<T, BlockSize> *instance)
+            {
+                this->instance = instance;
+                index = 0;
+                completed = false;
+            }
+            T *Next()
+            {
+                if (index >= instance->count)
+                {
+                    completed = true;
+                    return NULL;
+                }
+                return instance->Get(index++);
+            }
+        };
+        inline Iterator GetIterator()
+        {
+            return Iterator(this);
+        }
+    };
+}
\ No newline at end of file
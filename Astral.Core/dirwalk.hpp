@@ -0,0 +1,360 @@
+#pragma once
+
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "vector.hpp"
+#include <string.h>
+
+#if WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+#if POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+//Bytes of directory entries read per getdents64 call, one buffer per directory level being read
+#define DIRWALK_BUFFER_SIZE 32768
+
+//Streaming recursive directory walks. Every entry under a root is handed to a visitor as it is read, without building lists.
+//Entry types come from the directory listing itself (d_type, or the find data on Windows), so nothing is stat'ed,
+//subdirectories are opened relative to their parent's descriptor, and one path buffer is reused for the whole walk.
+//Symbolic links are reported but never followed, so link cycles cannot loop forever.
+
+namespace io
+{
+    enum DirectoryEntryType
+    {
+        DirectoryEntryType_File,
+        DirectoryEntryType_Directory,
+        DirectoryEntryType_Symlink,
+        DirectoryEntryType_Other
+    };
+
+    struct DirectoryEntry
+    {
+        //root followed by the entry's relative path, joined with '/'. Only valid during the visit, as the buffer is reused
+        const char *path;
+        usize pathLength;
+        //the final component of path
+        const char *name;
+        DirectoryEntryType type;
+        //0 for entries directly in the root
+        u32 depth;
+    };
+
+    //A growable path buffer, with entries appended and removed as the walk moves through directories
+    struct DirectoryWalkPath
+    {
+        IAllocator allocator;
+        char *buffer;
+        usize length;
+        usize capacity;
+
+        DirectoryWalkPath()
+        {
+            allocator = IAllocator();
+            buffer = NULL;
+            length = 0;
+            capacity = 0;
+        }
+        DirectoryWalkPath(IAllocator allocator, const char *root, usize rootLength)
+        {
+            this->allocator = allocator;
+            //trailing separators are dropped, except for a root of just "/"
+            while (rootLength > 1 && (root[rootLength - 1] == '/' || root[rootLength - 1] == '\\'))
+            {
+                rootLength--;
+            }
+            capacity = rootLength + 256;
+            buffer = (char*)allocator.Allocate(capacity);
+            memcpy(buffer, root, rootLength);
+            length = rootLength;
+            buffer[length] = 0;
+        }
+        void deinit()
+        {
+            allocator.FREEPTR(buffer);
+        }
+        //appends a separator and name, returning where name begins
+        usize Append(const char *name)
+        {
+            usize nameLength = strlen(name);
+            if (length + nameLength + 2 > capacity)
+            {
+                usize newCapacity = (length + nameLength + 2) * 2;
+                char *newBuffer = (char*)allocator.Allocate(newCapacity);
+                memcpy(newBuffer, buffer, length);
+                allocator.Free(buffer);
+                buffer = newBuffer;
+                capacity = newCapacity;
+            }
+            if (length > 0 && buffer[length - 1] != '/')
+            {
+                buffer[length++] = '/';
+            }
+            usize nameStart = length;
+            memcpy(buffer + length, name, nameLength + 1);
+            length += nameLength;
+            return nameStart;
+        }
+        inline void Truncate(usize newLength)
+        {
+            length = newLength;
+            buffer[length] = 0;
+        }
+        inline DirectoryEntry Enter(const char *name, DirectoryEntryType type, u32 depth)
+        {
+            usize nameStart = Append(name);
+            DirectoryEntry entry;
+            entry.path = buffer;
+            entry.pathLength = length;
+            entry.name = buffer + nameStart;
+            entry.type = type;
+            entry.depth = depth;
+            return entry;
+        }
+    };
+
+    inline bool IsDotDirectoryEntry(const char *name)
+    {
+        return name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0));
+    }
+
+#if WINDOWS
+    //calls func(name, type) for each entry of the directory at path
+    template<typename Func>
+    void ForEachDirectoryEntry(DirectoryWalkPath *path, Func &func)
+    {
+        usize baseLength = path->length;
+        path->Append("*");
+        WIN32_FIND_DATAA data;
+        //basic info skips looking up 8.3 short names, and large fetch asks for entries in bigger batches
+        HANDLE handle = FindFirstFileExA(path->buffer, FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+        path->Truncate(baseLength);
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+        do
+        {
+            if (IsDotDirectoryEntry(data.cFileName))
+            {
+                continue;
+            }
+            DirectoryEntryType type = DirectoryEntryType_File;
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+            {
+                type = DirectoryEntryType_Symlink;
+            }
+            else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                type = DirectoryEntryType_Directory;
+            }
+            func(data.cFileName, type);
+        } while (FindNextFileA(handle, &data));
+        FindClose(handle);
+    }
+#else
+    inline DirectoryEntryType DirectoryEntryTypeOf(int directory, const char *name, unsigned char type)
+    {
+        switch (type)
+        {
+            case DT_REG:
+                return DirectoryEntryType_File;
+            case DT_DIR:
+                return DirectoryEntryType_Directory;
+            case DT_LNK:
+                return DirectoryEntryType_Symlink;
+            case DT_UNKNOWN:
+                break;
+            default:
+                return DirectoryEntryType_Other;
+        }
+        //some filesystems do not fill in d_type
+        struct stat status;
+        if (fstatat(directory, name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            return DirectoryEntryType_Other;
+        }
+        if (S_ISREG(status.st_mode))
+        {
+            return DirectoryEntryType_File;
+        }
+        if (S_ISDIR(status.st_mode))
+        {
+            return DirectoryEntryType_Directory;
+        }
+        if (S_ISLNK(status.st_mode))
+        {
+            return DirectoryEntryType_Symlink;
+        }
+        return DirectoryEntryType_Other;
+    }
+    inline int OpenDirectoryAt(int parent, const char *name)
+    {
+        return openat(parent, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+    }
+
+#if defined(__linux__)
+    struct LinuxDirectoryEntry
+    {
+        u64 inode;
+        i64 offset;
+        unsigned short recordLength;
+        unsigned char type;
+        char name[1];
+    };
+#endif
+
+    //calls func(name, type) for each entry of the open directory. buffer must hold DIRWALK_BUFFER_SIZE bytes
+    template<typename Func>
+    void ForEachDirectoryEntry(int directory, u8 *buffer, Func &func)
+    {
+#if defined(__linux__)
+        //getdents64 fills the buffer with many entries per call, where readdir would need a copy and a call into libc for each
+        while (true)
+        {
+            long bytes = syscall(SYS_getdents64, directory, buffer, DIRWALK_BUFFER_SIZE);
+            if (bytes <= 0)
+            {
+                return;
+            }
+            long offset = 0;
+            while (offset < bytes)
+            {
+                LinuxDirectoryEntry *raw = (LinuxDirectoryEntry*)(buffer + offset);
+                offset += raw->recordLength;
+                if (IsDotDirectoryEntry(raw->name))
+                {
+                    continue;
+                }
+                func(raw->name, DirectoryEntryTypeOf(directory, raw->name, raw->type));
+            }
+        }
+#else
+        //fdopendir takes over the descriptor it is given, so it gets a copy
+        int copy = dup(directory);
+        DIR *handle = fdopendir(copy);
+        if (handle == NULL)
+        {
+            close(copy);
+            return;
+        }
+        struct dirent *raw;
+        while ((raw = readdir(handle)) != NULL)
+        {
+            if (IsDotDirectoryEntry(raw->d_name))
+            {
+                continue;
+            }
+            func(raw->d_name, DirectoryEntryTypeOf(directory, raw->d_name, raw->d_type));
+        }
+        closedir(handle);
+#endif
+    }
+#endif
+
+    inline bool DirectoryWalkAcceptAll(DirectoryEntry &)
+    {
+        return true;
+    }
+    typedef bool (*DirectoryWalkFilterFunc)(DirectoryEntry &entry);
+
+#if WINDOWS
+    template<typename Visitor, typename Filter>
+    void WalkDirectoryLevel(DirectoryWalkPath *path, u32 depth, Visitor &visitor, Filter &filter)
+    {
+        usize baseLength = path->length;
+        auto visit = [&](const char *name, DirectoryEntryType type)
+        {
+            DirectoryEntry entry = path->Enter(name, type, depth);
+            if (filter(entry))
+            {
+                visitor(entry);
+                if (type == DirectoryEntryType_Directory)
+                {
+                    WalkDirectoryLevel(path, depth + 1, visitor, filter);
+                }
+            }
+            path->Truncate(baseLength);
+        };
+        ForEachDirectoryEntry(path, visit);
+    }
+#else
+    template<typename Visitor, typename Filter>
+    void WalkDirectoryLevel(int directory, DirectoryWalkPath *path, u32 depth, collections::vector<u8*> *buffers, Visitor &visitor, Filter &filter)
+    {
+        //each level keeps its own buffer, as entries are still being read from it while deeper levels are walked
+        if (depth >= buffers->count)
+        {
+            buffers->Add((u8*)path->allocator.Allocate(DIRWALK_BUFFER_SIZE));
+        }
+        usize baseLength = path->length;
+        auto visit = [&](const char *name, DirectoryEntryType type)
+        {
+            DirectoryEntry entry = path->Enter(name, type, depth);
+            if (filter(entry))
+            {
+                visitor(entry);
+                if (type == DirectoryEntryType_Directory)
+                {
+                    int child = OpenDirectoryAt(directory, name);
+                    if (child >= 0)
+                    {
+                        WalkDirectoryLevel(child, path, depth + 1, buffers, visitor, filter);
+                        close(child);
+                    }
+                }
+            }
+            path->Truncate(baseLength);
+        };
+        ForEachDirectoryEntry(directory, buffers->ptr[depth], visit);
+    }
+#endif
+
+    //Calls visitor(DirectoryEntry &entry) for every entry under root, depth first. filter(DirectoryEntry &entry) is asked first:
+    //returning false skips the entry, and for a directory everything inside it too. Returns false if root could not be opened
+    template<typename Visitor, typename Filter>
+    bool WalkDirectory(IAllocator allocator, const char *root, Visitor visitor, Filter filter)
+    {
+        DirectoryWalkPath path = DirectoryWalkPath(allocator, root, strlen(root));
+#if WINDOWS
+        DWORD attributes = GetFileAttributesA(root);
+        if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            path.deinit();
+            return false;
+        }
+        WalkDirectoryLevel(&path, 0, visitor, filter);
+#else
+        int directory = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory < 0)
+        {
+            path.deinit();
+            return false;
+        }
+        collections::vector<u8*> buffers = collections::vector<u8*>(allocator);
+        WalkDirectoryLevel(directory, &path, 0, &buffers, visitor, filter);
+        close(directory);
+        for (usize i = 0; i < buffers.count; i++)
+        {
+            allocator.Free(buffers.ptr[i]);
+        }
+        buffers.deinit();
+#endif
+        path.deinit();
+        return true;
+    }
+    template<typename Visitor>
+    bool WalkDirectory(IAllocator allocator, const char *root, Visitor visitor)
+    {
+        return WalkDirectory(allocator, root, visitor, &DirectoryWalkAcceptAll);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,595 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "string.hpp"
+#include "queue.hpp"
+#include "hashmap.hpp"
+#include "hash.hpp"
+
+//How often the polling fallback rescans the watched directory, however often it is polled
+#ifndef FILEWATCH_POLL_INTERVAL_MS
+#define FILEWATCH_POLL_INTERVAL_MS 250
+#endif
+//Bytes of inotify events read per read call
+#ifndef FILEWATCH_EVENT_BUFFER_SIZE
+#define FILEWATCH_EVENT_BUFFER_SIZE 16384
+#endif
+
+//Watches a directory for files being created, modified or deleted, so that assets can be reloaded as they change.
+//On Linux this uses inotify: the kernel queues events as they happen, so a poll that finds nothing is a single read syscall
+//and waiting blocks without using any CPU. Elsewhere, or if inotify cannot be used (such as running out of watches),
+//the directory is rescanned at most every FILEWATCH_POLL_INTERVAL_MS and compared with the previous scan.
+//Define FILEWATCH_NO_INOTIFY to always poll.
+//A watcher is not thread safe, and should be polled from one thread at a time.
+
+namespace io
+{
+    enum FileChangeType
+    {
+        FileChangeType_Created,
+        //reported once the file is closed after being written, so it is never seen half written (inotify's IN_CLOSE_WRITE)
+        FileChangeType_Modified,
+        FileChangeType_Deleted,
+        //Changes were lost, because the system's event queue overflowed or the watcher fell back to polling when a directory could
+        //not be watched. path is the watched directory, and anything under it
+        //may have been created, modified or deleted since, so whatever was loaded from it should be checked again
+        FileChangeType_Rescan
+    };
+
+    struct FileChange
+    {
+        FileChangeType type;
+        //The watched directory followed by the file's relative path, joined with '/'. Allocated from the watcher's allocator,
+        //and owned by whoever takes the change off the queue, to be freed with deinit. Works with the path:: helpers
+        string path;
+        //For Rescan changes, and for Deleted changes reported by inotify when a directory was removed or moved away.
+        //In the latter case everything under path is gone, and for a directory moved away the files that were in it are not reported one by one
+        bool isDirectory;
+
+        FileChange()
+        {
+            type = FileChangeType_Created;
+            path = string();
+            isDirectory = false;
+        }
+        FileChange(FileChangeType type, string path, bool isDirectory)
+        {
+            this->type = type;
+            this->path = path;
+            this->isDirectory = isDirectory;
+        }
+        inline void deinit()
+        {
+            path.deinit();
+        }
+    };
+
+    typedef struct FileWatcherImpl *FileWatcher;
+
+    //Starts watching directory, and everything under it if recursive. Files already there are not reported.
+    //Returns NULL if directory cannot be opened
+    FileWatcher CreateFileWatcher(IAllocator allocator, const char *directory, bool recursive);
+    void DestroyFileWatcher(FileWatcher watcher);
+    //Whether changes come from inotify rather than rescanning
+    bool FileWatcherUsesInotify(FileWatcher watcher);
+
+    //Adds every change since the last poll to the end of changes without blocking, and returns how many were added.
+    //A file written soon after being created may be reported only as Created, and a file replaced by renaming another over it is reported as Created.
+    //If events were dropped, a single Rescan change is reported instead of what was lost
+    usize PollFileChanges(FileWatcher watcher, collections::queue<FileChange> *changes);
+    //As PollFileChanges, but blocks for up to timeoutMilliseconds until there is at least one change. 0 waits forever
+    usize WaitForFileChanges(FileWatcher watcher, collections::queue<FileChange> *changes, u32 timeoutMilliseconds);
+}
+
+#ifdef ASTRALCORE_FILEWATCH_IMPL
+
+#include <string.h>
+#include <sys/stat.h>
+#include "dirwalk.hpp"
+#ifdef WINDOWS
+#include "windows.h"
+#endif
+#ifdef POSIX
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#if defined(__linux__) && !defined(FILEWATCH_NO_INOTIFY)
+#define FILEWATCH_INOTIFY
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
+
+namespace io
+{
+    //what the polling fallback remembers about each file
+    struct FileWatchStamp
+    {
+        u64 modifiedTime;
+        u64 size;
+        //the scan that last saw the file, so files missing from the latest scan are known to be deleted
+        u32 generation;
+    };
+
+#ifdef FILEWATCH_INOTIFY
+    #define FILEWATCH_INOTIFY_MASK (IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+#endif
+
+    typedef struct FileWatcherImpl
+    {
+        IAllocator allocator;
+        string root;
+        bool recursive;
+        bool usingInotify;
+
+        //polling fallback
+        collections::hashmap<string, FileWatchStamp> files;
+        u32 generation;
+        u64 lastScan;
+
+#ifdef FILEWATCH_INOTIFY
+        i32 inotifyFd;
+        //path of the directory behind each watch descriptor
+        collections::hashmap<i32, string> watches;
+        alignas(struct inotify_event) u8 eventBuffer[FILEWATCH_EVENT_BUFFER_SIZE];
+#endif
+    } FileWatcherImpl;
+
+    inline u64 FileWatchMilliseconds()
+    {
+#ifdef WINDOWS
+        return GetTickCount64();
+#else
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (u64)now.tv_sec * 1000 + (u64)now.tv_nsec / 1000000;
+#endif
+    }
+    inline void FileWatchSleep(u32 milliseconds)
+    {
+#ifdef WINDOWS
+        Sleep(milliseconds);
+#else
+        usleep((useconds_t)milliseconds * 1000);
+#endif
+    }
+
+    //a string over a path that is not owned, for looking up and comparing
+    inline string FileWatchBorrow(const char *path, usize length)
+    {
+        string result = string();
+        result.buffer = (char*)path;
+        result.length = length + 1;
+        return result;
+    }
+
+    void FileWatcherPush(FileWatcher watcher, collections::queue<FileChange> *changes, FileChangeType type, const char *path, usize length, bool isDirectory)
+    {
+        //creating or writing a file ends with a close, which would report the same file twice in a row
+        if (type == FileChangeType_Modified && changes->count > 0)
+        {
+            FileChange *last = &changes->items[(changes->lastItemIndex + changes->capacity - 1) % changes->capacity];
+            if (last->type != FileChangeType_Deleted && last->path.length == length + 1 && memcmp(last->path.buffer, path, length) == 0)
+            {
+                return;
+            }
+        }
+        changes->Enqueue(FileChange(type, string(watcher->allocator, path, length), isDirectory));
+    }
+
+    //stats a walked entry, returning false for directories and anything that cannot be read
+    bool FileWatchStampOf(DirectoryEntry &entry, FileWatchStamp *stamp)
+    {
+        struct stat status;
+        if (stat(entry.path, &status) != 0 || (status.st_mode & S_IFMT) == S_IFDIR)
+        {
+            return false;
+        }
+#if defined(__APPLE__)
+        stamp->modifiedTime = (u64)status.st_mtimespec.tv_sec * 1000000000 + (u64)status.st_mtimespec.tv_nsec;
+#elif defined(POSIX)
+        stamp->modifiedTime = (u64)status.st_mtim.tv_sec * 1000000000 + (u64)status.st_mtim.tv_nsec;
+#else
+        stamp->modifiedTime = (u64)status.st_mtime;
+#endif
+        stamp->size = (u64)status.st_size;
+        return true;
+    }
+
+    //Compares the directory with the previous scan. changes is NULL for the first scan, which only records what is there
+    usize FileWatcherScan(FileWatcher watcher, collections::queue<FileChange> *changes)
+    {
+        usize added = 0;
+        watcher->generation++;
+        u32 generation = watcher->generation;
+        auto visit = [&](DirectoryEntry &entry)
+        {
+            if (entry.type == DirectoryEntryType_Directory)
+            {
+                return;
+            }
+            FileWatchStamp stamp;
+            if (!FileWatchStampOf(entry, &stamp))
+            {
+                return;
+            }
+            stamp.generation = generation;
+            FileWatchStamp *previous = watcher->files.Get(FileWatchBorrow(entry.path, entry.pathLength));
+            if (previous == NULL)
+            {
+                watcher->files.Add(string(watcher->allocator, entry.path, entry.pathLength), stamp);
+                if (changes != NULL)
+                {
+                    FileWatcherPush(watcher, changes, FileChangeType_Created, entry.path, entry.pathLength, false);
+                    added++;
+                }
+                return;
+            }
+            if (changes != NULL && (previous->modifiedTime != stamp.modifiedTime || previous->size != stamp.size))
+            {
+                usize before = changes->count;
+                FileWatcherPush(watcher, changes, FileChangeType_Modified, entry.path, entry.pathLength, false);
+                added += changes->count - before;
+            }
+            *previous = stamp;
+        };
+        auto filter = [&](DirectoryEntry &entry)
+        {
+            return watcher->recursive || entry.type != DirectoryEntryType_Directory;
+        };
+        WalkDirectory(watcher->allocator, watcher->root.buffer, visit, filter);
+
+        //anything not seen this time is gone. The map's key is handed to the change rather than copied
+        collections::vector<string> deleted = collections::vector<string>(watcher->allocator);
+        auto iterator = watcher->files.GetIterator();
+        foreach (entry, iterator)
+        {
+            if (entry->value.generation != generation)
+            {
+                deleted.Add(entry->key);
+            }
+        }
+        for (usize i = 0; i < deleted.count; i++)
+        {
+            watcher->files.Remove(deleted.ptr[i]);
+            if (changes != NULL)
+            {
+                changes->Enqueue(FileChange(FileChangeType_Deleted, deleted.ptr[i], false));
+                added++;
+            }
+            else
+            {
+                deleted.ptr[i].deinit();
+            }
+        }
+        deleted.deinit();
+        watcher->lastScan = FileWatchMilliseconds();
+        return added;
+    }
+    void FileWatcherStartPolling(FileWatcher watcher)
+    {
+        watcher->usingInotify = false;
+        watcher->files = collections::hashmap<string, FileWatchStamp>(watcher->allocator, &stringHash, &stringEql);
+        watcher->generation = 0;
+        FileWatcherScan(watcher, NULL);
+    }
+
+#ifdef FILEWATCH_INOTIFY
+    void FileWatcherStopInotify(FileWatcher watcher)
+    {
+        close(watcher->inotifyFd);
+        watcher->inotifyFd = -1;
+        auto iterator = watcher->watches.GetIterator();
+        foreach (entry, iterator)
+        {
+            entry->value.deinit();
+        }
+        watcher->watches.deinit();
+    }
+    //Returns false if the watch could not be added for a reason other than the directory having gone already
+    bool FileWatcherAddWatch(FileWatcher watcher, const char *path, usize length)
+    {
+        i32 watch = inotify_add_watch(watcher->inotifyFd, path, FILEWATCH_INOTIFY_MASK);
+        if (watch < 0)
+        {
+            return errno == ENOENT || errno == ENOTDIR || errno == EACCES;
+        }
+        //adding a directory that is already watched gives back its descriptor
+        string *existing = watcher->watches.Get(watch);
+        if (existing != NULL)
+        {
+            if (existing->length != length + 1 || memcmp(existing->buffer, path, length) != 0)
+            {
+                existing->deinit();
+                *existing = string(watcher->allocator, path, length);
+            }
+            return true;
+        }
+        watcher->watches.Add(watch, string(watcher->allocator, path, length));
+        return true;
+    }
+    //Watches every directory under path, reporting the files found as Created if changes is not NULL.
+    //Used for the root, for directories created or moved in, and to recover from dropped events
+    bool FileWatcherWatchTree(FileWatcher watcher, const char *path, usize length, collections::queue<FileChange> *changes, usize *added)
+    {
+        bool succeeded = FileWatcherAddWatch(watcher, path, length);
+        auto visit = [&](DirectoryEntry &entry)
+        {
+            if (entry.type == DirectoryEntryType_Directory)
+            {
+                succeeded = succeeded && FileWatcherAddWatch(watcher, entry.path, entry.pathLength);
+            }
+            else if (changes != NULL)
+            {
+                FileWatcherPush(watcher, changes, FileChangeType_Created, entry.path, entry.pathLength, false);
+                (*added)++;
+            }
+        };
+        auto filter = [&](DirectoryEntry &entry)
+        {
+            return succeeded && (watcher->recursive || entry.type != DirectoryEntryType_Directory);
+        };
+        if (!watcher->recursive && changes == NULL)
+        {
+            return succeeded;
+        }
+        WalkDirectory(watcher->allocator, path, visit, filter);
+        return succeeded;
+    }
+    //A directory moved away keeps its watches, which would then report under the old path, so they are removed along with every watch below it
+    void FileWatcherRemoveTree(FileWatcher watcher, const char *path, usize length)
+    {
+        collections::vector<i32> removed = collections::vector<i32>(watcher->allocator);
+        auto iterator = watcher->watches.GetIterator();
+        foreach (entry, iterator)
+        {
+            string watched = entry->value;
+            if (watched.length >= length + 1 && memcmp(watched.buffer, path, length) == 0 && (watched.buffer[length] == 0 || watched.buffer[length] == '/'))
+            {
+                removed.Add(entry->key);
+            }
+        }
+        for (usize i = 0; i < removed.count; i++)
+        {
+            inotify_rm_watch(watcher->inotifyFd, removed.ptr[i]);
+            watcher->watches.Get(removed.ptr[i])->deinit();
+            watcher->watches.Remove(removed.ptr[i]);
+        }
+        removed.deinit();
+    }
+    usize FileWatcherReadEvents(FileWatcher watcher, collections::queue<FileChange> *changes)
+    {
+        usize added = 0;
+        //path of the current event, reused between events
+        string path = string();
+        usize pathCapacity = 0;
+        //set when a watch could not be added, usually from reaching the limit on watches, so directories would go unwatched
+        bool fallBack = false;
+        while (!fallBack)
+        {
+            ssize_t bytes = read(watcher->inotifyFd, watcher->eventBuffer, FILEWATCH_EVENT_BUFFER_SIZE);
+            if (bytes <= 0)
+            {
+                if (bytes < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            ssize_t offset = 0;
+            while (offset < bytes)
+            {
+                struct inotify_event *event = (struct inotify_event*)(watcher->eventBuffer + offset);
+                offset += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    //events were dropped, so anything could have changed, including directories created without being watched.
+                    //Which files were deleted is not known without a list of every file, so the consumer is told to check everything
+                    if (!FileWatcherWatchTree(watcher, watcher->root.buffer, watcher->root.length - 1, NULL, NULL))
+                    {
+                        fallBack = true;
+                        break;
+                    }
+                    FileWatcherPush(watcher, changes, FileChangeType_Rescan, watcher->root.buffer, watcher->root.length - 1, true);
+                    added++;
+                    continue;
+                }
+                if (event->mask & IN_IGNORED)
+                {
+                    string *watched = watcher->watches.Get(event->wd);
+                    if (watched != NULL)
+                    {
+                        watched->deinit();
+                        watcher->watches.Remove(event->wd);
+                    }
+                    continue;
+                }
+                string *directory = watcher->watches.Get(event->wd);
+                if (directory == NULL || event->len == 0)
+                {
+                    continue;
+                }
+                usize directoryLength = directory->length - 1;
+                usize nameLength = strlen(event->name);
+                usize length = directoryLength + 1 + nameLength;
+                if (length + 1 > pathCapacity)
+                {
+                    if (path.buffer != NULL)
+                    {
+                        watcher->allocator.Free(path.buffer);
+                    }
+                    pathCapacity = (length + 1) * 2;
+                    path.buffer = (char*)watcher->allocator.Allocate(pathCapacity);
+                }
+                memcpy(path.buffer, directory->buffer, directoryLength);
+                path.buffer[directoryLength] = '/';
+                memcpy(path.buffer + directoryLength + 1, event->name, nameLength + 1);
+
+                if (event->mask & IN_ISDIR)
+                {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    {
+                        if (watcher->recursive && !FileWatcherWatchTree(watcher, path.buffer, length, changes, &added))
+                        {
+                            fallBack = true;
+                            break;
+                        }
+                    }
+                    else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                    {
+                        FileWatcherRemoveTree(watcher, path.buffer, length);
+                        FileWatcherPush(watcher, changes, FileChangeType_Deleted, path.buffer, length, true);
+                        added++;
+                    }
+                    continue;
+                }
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                {
+                    FileWatcherPush(watcher, changes, FileChangeType_Created, path.buffer, length, false);
+                    added++;
+                }
+                else if (event->mask & IN_CLOSE_WRITE)
+                {
+                    usize before = changes->count;
+                    FileWatcherPush(watcher, changes, FileChangeType_Modified, path.buffer, length, false);
+                    added += changes->count - before;
+                }
+                else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    FileWatcherPush(watcher, changes, FileChangeType_Deleted, path.buffer, length, false);
+                    added++;
+                }
+            }
+        }
+        if (path.buffer != NULL)
+        {
+            watcher->allocator.Free(path.buffer);
+        }
+        if (fallBack)
+        {
+            //the rest of the events, read or still queued, are dropped along with inotify, and polling only records what is there from now on
+            FileWatcherStopInotify(watcher);
+            FileWatcherStartPolling(watcher);
+            FileWatcherPush(watcher, changes, FileChangeType_Rescan, watcher->root.buffer, watcher->root.length - 1, true);
+            added++;
+        }
+        return added;
+    }
+#endif
+
+    FileWatcher CreateFileWatcher(IAllocator allocator, const char *directory, bool recursive)
+    {
+        struct stat status;
+        if (stat(directory, &status) != 0 || (status.st_mode & S_IFMT) != S_IFDIR)
+        {
+            return NULL;
+        }
+        FileWatcher watcher = (FileWatcher)allocator.Allocate(sizeof(FileWatcherImpl));
+        watcher->allocator = allocator;
+        //trailing separators are dropped, so that reported paths are joined with exactly one
+        usize length = strlen(directory);
+        while (length > 1 && (directory[length - 1] == '/' || directory[length - 1] == '\\'))
+        {
+            length--;
+        }
+        watcher->root = string(allocator, directory, length);
+        watcher->recursive = recursive;
+        watcher->usingInotify = false;
+        watcher->files = collections::hashmap<string, FileWatchStamp>();
+        watcher->generation = 0;
+        watcher->lastScan = 0;
+#ifdef FILEWATCH_INOTIFY
+        watcher->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watcher->inotifyFd >= 0)
+        {
+            watcher->watches = collections::hashmap<i32, string>(allocator, &i32Hash, &i32Eql);
+            watcher->usingInotify = true;
+            if (!FileWatcherWatchTree(watcher, watcher->root.buffer, length, NULL, NULL))
+            {
+                FileWatcherStopInotify(watcher);
+                watcher->usingInotify = false;
+            }
+        }
+#endif
+        if (!watcher->usingInotify)
+        {
+            FileWatcherStartPolling(watcher);
+        }
+        return watcher;
+    }
+    void DestroyFileWatcher(FileWatcher watcher)
+    {
+#ifdef FILEWATCH_INOTIFY
+        if (watcher->usingInotify)
+        {
+            FileWatcherStopInotify(watcher);
+        }
+#endif
+        if (!watcher->usingInotify)
+        {
+            auto iterator = watcher->files.GetIterator();
+            foreach (entry, iterator)
+            {
+                entry->key.deinit();
+            }
+            watcher->files.deinit();
+        }
+        watcher->root.deinit();
+        IAllocator allocator = watcher->allocator;
+        allocator.FREEPTR(watcher);
+    }
+    bool FileWatcherUsesInotify(FileWatcher watcher)
+    {
+        return watcher->usingInotify;
+    }
+
+    usize PollFileChanges(FileWatcher watcher, collections::queue<FileChange> *changes)
+    {
+#ifdef FILEWATCH_INOTIFY
+        if (watcher->usingInotify)
+        {
+            return FileWatcherReadEvents(watcher, changes);
+        }
+#endif
+        if (FileWatchMilliseconds() - watcher->lastScan < FILEWATCH_POLL_INTERVAL_MS)
+        {
+            return 0;
+        }
+        return FileWatcherScan(watcher, changes);
+    }
+    usize WaitForFileChanges(FileWatcher watcher, collections::queue<FileChange> *changes, u32 timeoutMilliseconds)
+    {
+        u64 start = FileWatchMilliseconds();
+        while (true)
+        {
+            usize added = PollFileChanges(watcher, changes);
+            if (added > 0)
+            {
+                return added;
+            }
+            u64 elapsed = FileWatchMilliseconds() - start;
+            if (timeoutMilliseconds != 0 && elapsed >= timeoutMilliseconds)
+            {
+                return 0;
+            }
+            u32 remaining = timeoutMilliseconds == 0 ? 0 : (u32)(timeoutMilliseconds - elapsed);
+#ifdef FILEWATCH_INOTIFY
+            if (watcher->usingInotify)
+            {
+                //sleeps in the kernel until an event is queued
+                struct pollfd waitFor;
+                waitFor.fd = watcher->inotifyFd;
+                waitFor.events = POLLIN;
+                waitFor.revents = 0;
+                poll(&waitFor, 1, timeoutMilliseconds == 0 ? -1 : (int)remaining);
+                continue;
+            }
+#endif
+            u64 sinceScan = FileWatchMilliseconds() - watcher->lastScan;
+            u32 untilScan = sinceScan >= FILEWATCH_POLL_INTERVAL_MS ? 0 : (u32)(FILEWATCH_POLL_INTERVAL_MS - sinceScan);
+            FileWatchSleep(timeoutMilliseconds != 0 && remaining < untilScan ? remaining : untilScan);
+        }
+    }
+}
+#endif
\ No newline at end of file
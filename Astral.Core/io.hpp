@@ -7,6 +7,7 @@
 #include "vector.hpp"
 #include "ArenaAllocator.hpp"
 #include "scope.hpp"
+#include "dirwalk.hpp"
 
 #include <sys/stat.h>   // For stat().
 
@@ -327,33 +328,23 @@ namespace io
 #endif
     }
 
+    //Every file under dirPath, at any depth. Links to files are included, links to directories are skipped rather than followed
     inline collections::Array<string> GetFilesInDirectoryRecursive(IAllocator allocator, const char* dirPath)
     {
-        ArenaAllocator arena = ArenaAllocator(GetCAllocator());
-        IAllocator alloc = arena.AsAllocator();
-        collections::vector<string> results = collections::vector<string>(alloc);
-        collections::vector<string> foldersToProcess = collections::vector<string>(alloc);
-        foldersToProcess.Add(string(alloc, dirPath));
-
-        while (foldersToProcess.count > 0)
+        collections::vector<string> results = collections::vector<string>(allocator);
+        WalkDirectory(GetCAllocator(), dirPath, [&](DirectoryEntry &entry)
         {
-            string folder = foldersToProcess.ptr[0];
-            foldersToProcess.RemoveAt_Swap(0);
-
-            collections::Array<string> filesInThisDir = GetFilesInDirectory(alloc, folder.buffer);
-            for (usize i = 0; i < filesInThisDir.length; i++)
+            if (entry.type == DirectoryEntryType_Directory)
             {
-                results.Add(filesInThisDir[i].Clone(allocator));
+                return;
             }
-            collections::Array<string> foldersInThisDir = GetFoldersInDirectory(alloc, folder.buffer);
-            for (usize i = 0; i < foldersInThisDir.length; i++)
+            //only links need a stat, to find what they point to
+            if (entry.type == DirectoryEntryType_Symlink && (!FileExists(entry.path) || DirectoryExists(entry.path)))
             {
-                foldersToProcess.Add(foldersInThisDir[i]);
+                return;
             }
-        }
-        collections::Array<string> finalArray = results.ToClonedArray(allocator);
-        arena.deinit();
-
-        return finalArray;
+            results.Add(string(allocator, entry.path));
+        });
+        return results.ToOwnedArray();
     }
 }
\ No newline at end of file
@@ -0,0 +1,532 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "queue.hpp"
+#include "threading.hpp"
+
+//Jobs each worker can hold before further jobs it submits are run immediately instead of queued
+#ifndef JOBSYSTEM_DEQUE_CAPACITY
+#define JOBSYSTEM_DEQUE_CAPACITY 4096
+#endif
+#define JOBSYSTEM_MAX_WORKERS 256
+//Failed searches for work before an idle thread starts yielding its time slice instead of spinning
+#define JOBSYSTEM_IDLE_SPINS 256
+//Further failed searches, each after yielding, before an idle worker thread goes to sleep until a job is scheduled
+#define JOBSYSTEM_IDLE_YIELDS 64
+#define JOBSYSTEM_CACHE_LINE 64
+
+namespace threading
+{
+    def_delegate(JobFunc, void, void*);
+    struct JobCounter;
+
+    //A unit of work. Jobs are owned by the caller and are not copied, so they must stay alive until they have run,
+    //which is usually done by keeping them next to the counter that is waited on
+    struct Job
+    {
+        JobFunc function;
+        void *data;
+        //decremented once the job has finished, may be NULL
+        JobCounter *counter;
+        //links jobs waiting for the same dependency
+        Job *nextContinuation;
+
+        Job()
+        {
+            function = NULL;
+            data = NULL;
+            counter = NULL;
+            nextContinuation = NULL;
+        }
+        Job(JobFunc function, void *data)
+        {
+            this->function = function;
+            this->data = data;
+            counter = NULL;
+            nextContinuation = NULL;
+        }
+    };
+
+    //Counts submitted jobs that have not finished yet. Can be waited on with WaitForCounter,
+    //and used as a dependency of jobs started with RunJobAfter. Must be zero (finished) before it goes out of scope
+    struct JobCounter
+    {
+        volatile i64 pending;
+        //threads currently finishing a job of this counter, so that waiters do not return while the counter is still being touched
+        volatile i64 finishing;
+        //jobs to schedule once pending reaches zero
+        void *volatile continuations;
+
+        JobCounter()
+        {
+            pending = 0;
+            finishing = 0;
+            continuations = NULL;
+        }
+    };
+
+    //Chase-Lev work stealing deque with a fixed capacity. The owning worker pushes and pops jobs at the bottom without
+    //contention, while other workers steal the oldest jobs from the top with a single compare exchange.
+    //top and bottom are kept on separate cache lines since thieves and the owner write them independently
+    struct JobDeque
+    {
+        volatile i64 top;
+        u8 topPadding[JOBSYSTEM_CACHE_LINE - sizeof(i64)];
+        volatile i64 bottom;
+        u8 bottomPadding[JOBSYSTEM_CACHE_LINE - sizeof(i64)];
+        void *volatile buffer[JOBSYSTEM_DEQUE_CAPACITY];
+
+        //The memory orders follow Le, Pop, Cohen and Zappa Nardelli's proof of the deque under the C11 model:
+        //only the owner's pop and a thief's steal need full fences, to agree on who takes the last job
+
+        //owner only. Returns false if the deque is full
+        inline bool Push(Job *job)
+        {
+            i64 currentBottom = AtomicLoad64(&bottom, MemoryOrder_Relaxed);
+            i64 currentTop = AtomicLoad64(&top, MemoryOrder_Acquire);
+            if (currentBottom - currentTop >= JOBSYSTEM_DEQUE_CAPACITY)
+            {
+                return false;
+            }
+            AtomicStorePointer(&buffer[currentBottom & (JOBSYSTEM_DEQUE_CAPACITY - 1)], job, MemoryOrder_Relaxed);
+            AtomicThreadFence(MemoryOrder_Release);
+            AtomicStore64(&bottom, currentBottom + 1, MemoryOrder_Relaxed);
+            return true;
+        }
+        //owner only. Takes the most recently pushed job, or NULL
+        inline Job *Pop()
+        {
+            i64 currentBottom = AtomicLoad64(&bottom, MemoryOrder_Relaxed) - 1;
+            AtomicStore64(&bottom, currentBottom, MemoryOrder_Relaxed);
+            AtomicThreadFence(MemoryOrder_SeqCst);
+            i64 currentTop = AtomicLoad64(&top, MemoryOrder_Relaxed);
+            if (currentTop > currentBottom)
+            {
+                //empty
+                AtomicStore64(&bottom, currentBottom + 1, MemoryOrder_Relaxed);
+                return NULL;
+            }
+            Job *job = (Job*)AtomicLoadPointer(&buffer[currentBottom & (JOBSYSTEM_DEQUE_CAPACITY - 1)], MemoryOrder_Relaxed);
+            if (currentTop == currentBottom)
+            {
+                //last job, race any thieves for it
+                if (!AtomicCompareExchange64(&top, &currentTop, currentTop + 1, MemoryOrder_SeqCst))
+                {
+                    job = NULL;
+                }
+                AtomicStore64(&bottom, currentBottom + 1, MemoryOrder_Relaxed);
+            }
+            return job;
+        }
+        //any thread. Takes the oldest job, or NULL if the deque is empty or another thread won the race for it
+        inline Job *Steal()
+        {
+            i64 currentTop = AtomicLoad64(&top, MemoryOrder_Acquire);
+            AtomicThreadFence(MemoryOrder_SeqCst);
+            i64 currentBottom = AtomicLoad64(&bottom, MemoryOrder_Acquire);
+            if (currentTop >= currentBottom)
+            {
+                return NULL;
+            }
+            Job *job = (Job*)AtomicLoadPointer(&buffer[currentTop & (JOBSYSTEM_DEQUE_CAPACITY - 1)], MemoryOrder_Relaxed);
+            if (!AtomicCompareExchange64(&top, &currentTop, currentTop + 1, MemoryOrder_SeqCst))
+            {
+                return NULL;
+            }
+            return job;
+        }
+    };
+
+    struct JobSystem;
+    //Aligned to a cache line, so that each deque's top starts a line of its own and shares nothing with the previous worker
+    struct alignas(JOBSYSTEM_CACHE_LINE) JobWorker
+    {
+        JobDeque deque;
+        JobSystem *system;
+        Thread thread;
+        u32 index;
+        u64 randomState;
+    };
+
+    //A fixed pool of worker threads that share jobs through work stealing. The thread that creates the job system
+    //is worker 0 and takes part whenever it waits on a counter, so a system of N workers starts N - 1 threads.
+    //Jobs may be submitted from any thread; those from threads outside the pool go through a shared locked queue.
+    struct JobSystem
+    {
+        IAllocator allocator;
+        JobWorker *workers;
+        //allocators only promise malloc's alignment, so workers is placed at the first cache line boundary within this
+        void *workersAllocation;
+        u32 workerCount;
+        volatile i64 running;
+
+        ThreadLock injectedLock;
+        collections::queue<Job*> injected;
+        volatile i64 injectedCount;
+
+        //idle workers sleep on this, and scheduling a job releases it once if any are sleeping
+        Semaphore wakeSignal;
+        volatile i32 sleepingWorkers;
+    };
+
+    //workerCount of 0 or less creates one worker per CPU
+    JobSystem *CreateJobSystem(IAllocator allocator, i32 workerCount);
+    //Must be called from the thread that created the system, once no jobs are pending
+    void DestroyJobSystem(JobSystem *system);
+
+    //Schedules a job. If counter is not NULL, it is incremented now and decremented once the job has run
+    void RunJob(JobSystem *system, Job *job, JobCounter *counter);
+    void RunJobs(JobSystem *system, Job *jobs, usize count, JobCounter *counter);
+    //Schedules a job to run once dependency reaches zero (or now if it already has).
+    //counter is incremented immediately, so waiting on it also waits for the dependency
+    void RunJobAfter(JobSystem *system, JobCounter *dependency, Job *job, JobCounter *counter);
+    //Runs other jobs on the calling thread until counter reaches zero, instead of blocking
+    void WaitForCounter(JobSystem *system, JobCounter *counter);
+    //Runs a single pending job on the calling thread if one can be found, returning whether one was run
+    bool RunPendingJob(JobSystem *system);
+    //Index of the calling thread within the pool, or -1 if it is not one of the system's workers
+    i32 GetCurrentWorkerIndex(JobSystem *system);
+}
+
+#ifdef ASTRALCORE_JOBSYSTEM_IMPL
+
+namespace threading
+{
+    static thread_local JobWorker *currentJobWorker = NULL;
+
+    inline JobWorker *GetCurrentWorker(JobSystem *system)
+    {
+        JobWorker *worker = currentJobWorker;
+        return worker != NULL && worker->system == system ? worker : NULL;
+    }
+    i32 GetCurrentWorkerIndex(JobSystem *system)
+    {
+        JobWorker *worker = GetCurrentWorker(system);
+        return worker == NULL ? -1 : (i32)worker->index;
+    }
+
+    void ScheduleJob(JobSystem *system, Job *job);
+    void ExecuteJob(JobSystem *system, Job *job);
+
+    void FinishJobCounter(JobSystem *system, JobCounter *counter)
+    {
+        AtomicFetchAdd64(&counter->finishing, 1);
+        if (AtomicFetchAdd64(&counter->pending, -1) == 1)
+        {
+            Job *continuation = (Job*)AtomicExchangePointer(&counter->continuations, NULL);
+            while (continuation != NULL)
+            {
+                Job *next = continuation->nextContinuation;
+                ScheduleJob(system, continuation);
+                continuation = next;
+            }
+        }
+        AtomicFetchAdd64(&counter->finishing, -1);
+    }
+    void ExecuteJob(JobSystem *system, Job *job)
+    {
+        //the job may be freed by its owner as soon as the counter is decremented, so read it first
+        JobCounter *counter = job->counter;
+        job->function(job->data);
+        if (counter != NULL)
+        {
+            FinishJobCounter(system, counter);
+        }
+    }
+    inline void WakeSleepingWorker(JobSystem *system)
+    {
+        //pairs with the fence in JobWorkerMain: either the sleeping worker sees the new job, or this sees the worker
+        AtomicThreadFence(MemoryOrder_SeqCst);
+        if (AtomicLoad32(&system->sleepingWorkers, MemoryOrder_Relaxed) > 0)
+        {
+            system->wakeSignal.Release();
+        }
+    }
+    void ScheduleJob(JobSystem *system, Job *job)
+    {
+        JobWorker *worker = GetCurrentWorker(system);
+        if (worker != NULL)
+        {
+            if (!worker->deque.Push(job))
+            {
+                ExecuteJob(system, job);
+                return;
+            }
+        }
+        else
+        {
+            LockThreadLock(system->injectedLock);
+            system->injected.Enqueue(job);
+            AtomicFetchAdd64(&system->injectedCount, 1);
+            UnlockThreadLock(system->injectedLock);
+        }
+        WakeSleepingWorker(system);
+    }
+
+    inline u64 NextJobRandom(u64 *state)
+    {
+        u64 x = *state;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        *state = x;
+        return x;
+    }
+    //finds a job from the worker's own deque, then the shared queue, then by stealing from the other workers starting at a random one
+    Job *FindJob(JobSystem *system, JobWorker *worker, u64 *randomState)
+    {
+        if (worker != NULL)
+        {
+            Job *job = worker->deque.Pop();
+            if (job != NULL)
+            {
+                return job;
+            }
+        }
+        if (AtomicLoad64(&system->injectedCount, MemoryOrder_Relaxed) > 0)
+        {
+            Job *job = NULL;
+            LockThreadLock(system->injectedLock);
+            if (system->injected.count > 0)
+            {
+                job = system->injected.Dequeue();
+                AtomicFetchAdd64(&system->injectedCount, -1);
+            }
+            UnlockThreadLock(system->injectedLock);
+            if (job != NULL)
+            {
+                return job;
+            }
+        }
+        u32 start = (u32)(NextJobRandom(randomState) % system->workerCount);
+        for (u32 i = 0; i < system->workerCount; i++)
+        {
+            JobWorker *victim = &system->workers[(start + i) % system->workerCount];
+            if (victim == worker)
+            {
+                continue;
+            }
+            Job *job = victim->deque.Steal();
+            if (job != NULL)
+            {
+                return job;
+            }
+        }
+        return NULL;
+    }
+
+    THREAD_RESULT JobWorkerMain(void *args)
+    {
+        JobWorker *worker = (JobWorker*)args;
+        JobSystem *system = worker->system;
+        currentJobWorker = worker;
+        //named "JobWorker <index>" for debuggers and profilers
+        char name[16] = "JobWorker ";
+        usize digits = 0;
+        for (u32 remaining = worker->index; remaining > 0 || digits == 0; remaining /= 10)
+        {
+            digits++;
+        }
+        for (u32 remaining = worker->index, i = 0; i < digits; remaining /= 10, i++)
+        {
+            name[10 + digits - 1 - i] = (char)('0' + remaining % 10);
+        }
+        name[10 + digits] = 0;
+        SetCurrentThreadName(name);
+        u32 idle = 0;
+        while (AtomicLoad64(&system->running, MemoryOrder_Relaxed) != 0)
+        {
+            Job *job = FindJob(system, worker, &worker->randomState);
+            if (job != NULL)
+            {
+                ExecuteJob(system, job);
+                idle = 0;
+            }
+            else if (idle < JOBSYSTEM_IDLE_SPINS)
+            {
+                idle++;
+                SpinPause();
+            }
+            else if (idle < JOBSYSTEM_IDLE_SPINS + JOBSYSTEM_IDLE_YIELDS)
+            {
+                idle++;
+                YieldThread();
+            }
+            else
+            {
+                //announce the sleep before looking one last time, so a job scheduled in between is either found here or wakes us
+                AtomicFetchAdd32(&system->sleepingWorkers, 1);
+                AtomicThreadFence(MemoryOrder_SeqCst);
+                job = FindJob(system, worker, &worker->randomState);
+                if (job == NULL && AtomicLoad64(&system->running, MemoryOrder_Relaxed) != 0)
+                {
+                    system->wakeSignal.Acquire();
+                }
+                AtomicFetchAdd32(&system->sleepingWorkers, -1);
+                if (job != NULL)
+                {
+                    ExecuteJob(system, job);
+                }
+                idle = 0;
+            }
+        }
+        currentJobWorker = NULL;
+        return (THREAD_RESULT)0;
+    }
+
+    JobSystem *CreateJobSystem(IAllocator allocator, i32 workerCount)
+    {
+        if (workerCount <= 0)
+        {
+            workerCount = GetCPUCount();
+        }
+        if (workerCount < 1)
+        {
+            workerCount = 1;
+        }
+        if (workerCount > JOBSYSTEM_MAX_WORKERS)
+        {
+            workerCount = JOBSYSTEM_MAX_WORKERS;
+        }
+        JobSystem *system = (JobSystem*)allocator.Allocate(sizeof(JobSystem));
+        system->allocator = allocator;
+        system->workerCount = (u32)workerCount;
+        system->workersAllocation = allocator.Allocate(sizeof(JobWorker) * workerCount + JOBSYSTEM_CACHE_LINE - 1);
+        system->workers = (JobWorker*)(((usize)system->workersAllocation + JOBSYSTEM_CACHE_LINE - 1) & ~(usize)(JOBSYSTEM_CACHE_LINE - 1));
+        system->running = 1;
+        system->injectedLock = CreateThreadLock();
+        system->injected = collections::queue<Job*>(allocator);
+        system->injectedCount = 0;
+        system->wakeSignal = Semaphore();
+        system->sleepingWorkers = 0;
+
+        for (u32 i = 0; i < system->workerCount; i++)
+        {
+            JobWorker *worker = &system->workers[i];
+            worker->deque.top = 0;
+            worker->deque.bottom = 0;
+            worker->system = system;
+            worker->thread = NULL;
+            worker->index = i;
+            worker->randomState = 0x9E3779B97F4A7C15ull * (i + 1);
+        }
+        currentJobWorker = &system->workers[0];
+        for (u32 i = 1; i < system->workerCount; i++)
+        {
+            system->workers[i].thread = StartThread(&JobWorkerMain, &system->workers[i]);
+        }
+        return system;
+    }
+    void DestroyJobSystem(JobSystem *system)
+    {
+        AtomicStore64(&system->running, 0);
+        system->wakeSignal.Release((i32)system->workerCount);
+        for (u32 i = 1; i < system->workerCount; i++)
+        {
+            JoinThread(system->workers[i].thread);
+        }
+        if (currentJobWorker != NULL && currentJobWorker->system == system)
+        {
+            currentJobWorker = NULL;
+        }
+        DestroyThreadLock(system->injectedLock);
+        system->injected.deinit();
+        IAllocator allocator = system->allocator;
+        allocator.FREEPTR(system->workersAllocation);
+        allocator.FREEPTR(system);
+    }
+
+    void RunJob(JobSystem *system, Job *job, JobCounter *counter)
+    {
+        job->counter = counter;
+        if (counter != NULL)
+        {
+            AtomicFetchAdd64(&counter->pending, 1);
+        }
+        ScheduleJob(system, job);
+    }
+    void RunJobs(JobSystem *system, Job *jobs, usize count, JobCounter *counter)
+    {
+        if (counter != NULL)
+        {
+            AtomicFetchAdd64(&counter->pending, (i64)count);
+        }
+        for (usize i = 0; i < count; i++)
+        {
+            jobs[i].counter = counter;
+            ScheduleJob(system, &jobs[i]);
+        }
+    }
+    void RunJobAfter(JobSystem *system, JobCounter *dependency, Job *job, JobCounter *counter)
+    {
+        job->counter = counter;
+        if (counter != NULL)
+        {
+            AtomicFetchAdd64(&counter->pending, 1);
+        }
+        if (AtomicLoad64(&dependency->pending) == 0)
+        {
+            ScheduleJob(system, job);
+            return;
+        }
+        void *head = AtomicLoadPointer(&dependency->continuations);
+        do
+        {
+            job->nextContinuation = (Job*)head;
+        } while (!AtomicCompareExchangePointer(&dependency->continuations, &head, job));
+
+        //the dependency may have finished before the job was added, in which case nobody else will schedule it.
+        //taking the whole list schedules every continuation exactly once, whichever thread gets it
+        if (AtomicLoad64(&dependency->pending) == 0)
+        {
+            Job *continuation = (Job*)AtomicExchangePointer(&dependency->continuations, NULL);
+            while (continuation != NULL)
+            {
+                Job *next = continuation->nextContinuation;
+                ScheduleJob(system, continuation);
+                continuation = next;
+            }
+        }
+    }
+
+    bool RunPendingJob(JobSystem *system)
+    {
+        JobWorker *worker = GetCurrentWorker(system);
+        u64 localRandom = (u64)(usize)&worker ^ 0x9E3779B97F4A7C15ull;
+        Job *job = FindJob(system, worker, worker != NULL ? &worker->randomState : &localRandom);
+        if (job == NULL)
+        {
+            return false;
+        }
+        ExecuteJob(system, job);
+        return true;
+    }
+    void WaitForCounter(JobSystem *system, JobCounter *counter)
+    {
+        JobWorker *worker = GetCurrentWorker(system);
+        u64 localRandom = (u64)(usize)&worker ^ 0x9E3779B97F4A7C15ull;
+        u64 *randomState = worker != NULL ? &worker->randomState : &localRandom;
+        u32 idle = 0;
+        while (AtomicLoad64(&counter->pending, MemoryOrder_Acquire) != 0)
+        {
+            Job *job = FindJob(system, worker, randomState);
+            if (job != NULL)
+            {
+                ExecuteJob(system, job);
+                idle = 0;
+            }
+            else if (idle < JOBSYSTEM_IDLE_SPINS)
+            {
+                idle++;
+                SpinPause();
+            }
+            else YieldThread();
+        }
+        while (AtomicLoad64(&counter->finishing, MemoryOrder_Acquire) != 0)
+        {
+            SpinPause();
+        }
+    }
+}
+
+#endif
\ No newline at end of file
@@ -1,7 +1,16 @@
 #pragma once
-#if 0
-#error todo
+#include "Linxc.h"
 #include "allocators.hpp"
+#include "vector.hpp"
+
+#ifndef foreach
+#define foreach(instance, iterator) for (auto instance = iterator.Next(); !iterator.completed; instance = iterator.Next())
+#endif
+
+//marks the end of the list, or no node at all
+#define LINKEDVECTORS_NONE -1
+//stored in prev of removed slots so that stale indices can be caught
+#define LINKEDVECTORS_FREED -2
 
 namespace collections
 {
@@ -13,169 +22,283 @@ namespace collections
 		T value;
 	};
 
+	//A doubly linked list whose nodes live contiguously in a vector and link to each other by index.
+	//Removed slots are threaded into a free list through their next index and reused by later insertions,
+	//so the list only allocates when it grows past its largest size.
+	//Indices returned by the Add functions stay valid until that node is removed, even if the list reallocates.
 	template<typename T>
 	struct linkedvectors
 	{
 		IAllocator allocator;
 		collections::vector<LinkedVecNode<T>> elements;
-		collections::vector<i32> freeIndices;
+		i32 freeIndex;
 		i32 firstIndex;
 		i32 lastIndex;
 		usize count;
 
-		linkedlist()
+		linkedvectors()
 		{
 			allocator = IAllocator{};
-			elements = collections::vector<linkednode<T>>();
-			freeIndices = collections::vector<i32>();
-			firstIndex = -1;
-			lastIndex = -1;
+			elements = collections::vector<LinkedVecNode<T>>();
+			freeIndex = LINKEDVECTORS_NONE;
+			firstIndex = LINKEDVECTORS_NONE;
+			lastIndex = LINKEDVECTORS_NONE;
 			count = 0;
 		}
-		linkedlist(IAllocator myAllocator)
+		linkedvectors(IAllocator myAllocator)
 		{
 			allocator = myAllocator;
-			elements = collections::vector<linkednode<T>>(allocator);
-			freeIndices = collections::vector<i32>(allocator);
-			firstIndex = -1;
-			lastIndex = -1;
+			elements = collections::vector<LinkedVecNode<T>>(myAllocator);
+			freeIndex = LINKEDVECTORS_NONE;
+			firstIndex = LINKEDVECTORS_NONE;
+			lastIndex = LINKEDVECTORS_NONE;
 			count = 0;
 		}
-		/*bool AddListAfter(linkednode<T>* after, linkedlist<T>* listToAdd)
+		linkedvectors(IAllocator myAllocator, usize minCapacity)
 		{
-			//operation can only continue if listToAdd has objects within, and the allocator is the same instance
-			if (listToAdd->allocator != this->allocator || listToAdd->first == NULL || listToAdd->last == NULL)
-			{
-				return false;
-			}
-			//transfer list ownership
-			linkednode<T>* node = listToAdd->first;
-			while (node != NULL)
-			{
-				node->list = this;
-				node = node->next;
-			}
+			allocator = myAllocator;
+			elements = collections::vector<LinkedVecNode<T>>(myAllocator, minCapacity);
+			freeIndex = LINKEDVECTORS_NONE;
+			firstIndex = LINKEDVECTORS_NONE;
+			lastIndex = LINKEDVECTORS_NONE;
+			count = 0;
+		}
+		void deinit()
+		{
+			elements.deinit();
+			freeIndex = LINKEDVECTORS_NONE;
+			firstIndex = LINKEDVECTORS_NONE;
+			lastIndex = LINKEDVECTORS_NONE;
+			count = 0;
+		}
+		void Clear()
+		{
+			elements.Clear();
+			freeIndex = LINKEDVECTORS_NONE;
+			firstIndex = LINKEDVECTORS_NONE;
+			lastIndex = LINKEDVECTORS_NONE;
+			count = 0;
+		}
 
-			linkednode<T>* originalNext = after->next;
-			after->next = listToAdd->first;
-			listToAdd->first->prev = after;
-			originalNext->prev = listToAdd->last;
-			listToAdd->last->next = originalNext;
-			this->count += listToAdd->count;
+		inline bool IsValid(i32 index)
+		{
+			return index >= 0 && (usize)index < elements.count && elements.ptr[index].prev != LINKEDVECTORS_FREED;
+		}
+		inline LinkedVecNode<T>* GetNode(i32 index)
+		{
+			return &elements.ptr[index];
+		}
+		inline T* Get(i32 index)
+		{
+			return &elements.ptr[index].value;
+		}
+		inline i32 Next(i32 index)
+		{
+			return elements.ptr[index].next;
+		}
+		inline i32 Prev(i32 index)
+		{
+			return elements.ptr[index].prev;
+		}
 
-			listToAdd->count = 0;
-			listToAdd->first = NULL;
-			listToAdd->last = NULL;
-			return true;
-		}*/
-		linkednode<T>* AddBefore(T item, linkednode<T>* before)
-		{
-			linkednode<T>* node = (linkednode<T>*)allocator.Allocate(sizeof(linkednode<T>));
-			node->list = this;
-			node->value = item;
-			linkednode<T>* originalPrev = before->prev;
-			before->prev = node;
-			node->next = before;
-			node->prev = originalPrev;
-			if (originalPrev != NULL)
-			{
-				originalPrev->next = node;
+		i32 AllocateNode(T item)
+		{
+			i32 index;
+			if (freeIndex != LINKEDVECTORS_NONE)
+			{
+				index = freeIndex;
+				freeIndex = elements.ptr[index].next;
 			}
 			else
 			{
-				node->list->first = node;
+				index = (i32)elements.count;
+				elements.Add(LinkedVecNode<T>());
 			}
+			elements.ptr[index].value = item;
 			count += 1;
-			return node;
+			return index;
 		}
-		linkednode<T>* AddAfter(T item, linkednode<T>* after)
+		i32 AddBefore(T item, i32 before)
 		{
-			linkednode<T>* node = (linkednode<T>*)allocator.Allocate(sizeof(linkednode<T>));
-			node->list = this;
-			node->value = item;
-			linkednode<T>* originalNext = after->next;
-			after->next = node;
-			node->prev = after;
-			node->next = originalNext;
-			if (originalNext != NULL)
+			assert(IsValid(before));
+			i32 index = AllocateNode(item);
+			LinkBefore(index, before);
+			return index;
+		}
+		i32 AddAfter(T item, i32 after)
+		{
+			assert(IsValid(after));
+			i32 index = AllocateNode(item);
+			LinkAfter(index, after);
+			return index;
+		}
+		i32 Append(T item)
+		{
+			if (lastIndex != LINKEDVECTORS_NONE)
 			{
-				originalNext->prev = node;
+				return AddAfter(item, lastIndex);
 			}
-			else
+			i32 index = AllocateNode(item);
+			elements.ptr[index].prev = LINKEDVECTORS_NONE;
+			elements.ptr[index].next = LINKEDVECTORS_NONE;
+			firstIndex = index;
+			lastIndex = index;
+			return index;
+		}
+		i32 Prepend(T item)
+		{
+			if (firstIndex != LINKEDVECTORS_NONE)
 			{
-				node->list->last = node;
+				return AddBefore(item, firstIndex);
 			}
-			count += 1;
-			return node;
+			return Append(item);
 		}
-		linkednode<T>* Append(T item)
+		void Remove(i32 index)
 		{
-			if (this->last != NULL)
+			assert(IsValid(index));
+			Unlink(index);
+			elements.ptr[index].value = T();
+			elements.ptr[index].prev = LINKEDVECTORS_FREED;
+			elements.ptr[index].next = freeIndex;
+			freeIndex = index;
+			count -= 1;
+		}
+		T RemoveFirst()
+		{
+			if (firstIndex == LINKEDVECTORS_NONE)
 			{
-				return AddAfter(item, this->last);
+				return T();
 			}
-			linkednode<T>* node = (linkednode<T>*)allocator.Allocate(sizeof(linkednode<T>));
-			node->list = this;
-			node->value = item;
-			node->prev = NULL;
-			node->next = NULL;
-			this->first = node;
-			this->last = node;
-			count += 1;
-			return node;
+			T result = elements.ptr[firstIndex].value;
+			Remove(firstIndex);
+			return result;
 		}
-		linkednode<T>* Prepend(T item)
+		T RemoveLast()
 		{
-			if (this->first != NULL)
+			if (lastIndex == LINKEDVECTORS_NONE)
 			{
-				return AddBefore(item, this->first);
+				return T();
 			}
-			linkednode<T>* node = (linkednode<T>*)allocator.Allocate(sizeof(linkednode<T>));
-			node->list = this;
-			node->value = item;
-			node->prev = NULL;
-			node->next = NULL;
-			this->first = node;
-			this->last = node;
-			count += 1;
-			return node;
+			T result = elements.ptr[lastIndex].value;
+			Remove(lastIndex);
+			return result;
+		}
+		//moves an existing node to the start of the list without reallocating it, as used by LRU caches on access
+		void MoveToFront(i32 index)
+		{
+			assert(IsValid(index));
+			if (index == firstIndex)
+			{
+				return;
+			}
+			Unlink(index);
+			LinkBefore(index, firstIndex);
+		}
+		void MoveToBack(i32 index)
+		{
+			assert(IsValid(index));
+			if (index == lastIndex)
+			{
+				return;
+			}
+			Unlink(index);
+			LinkAfter(index, lastIndex);
 		}
-		void Remove(linkednode<T>* node, bool dispose = true)
+
+		void Unlink(i32 index)
 		{
-			if (node->next == NULL)
+			LinkedVecNode<T>* node = &elements.ptr[index];
+			if (node->next == LINKEDVECTORS_NONE)
 			{
-				node->list->last = node->prev;
+				lastIndex = node->prev;
 			}
 			else
 			{
-				node->next->prev = node->prev;
+				elements.ptr[node->next].prev = node->prev;
 			}
 
-			if (node->prev == NULL)
+			if (node->prev == LINKEDVECTORS_NONE)
 			{
-				node->list->first = node->next;
+				firstIndex = node->next;
 			}
 			else
 			{
-				node->prev->next = node->next;
+				elements.ptr[node->prev].next = node->next;
 			}
-			node->list->count -= 1;
-			if (dispose)
+		}
+		void LinkBefore(i32 index, i32 before)
+		{
+			if (before == LINKEDVECTORS_NONE)
 			{
-				node->list->allocator.Free(node);
+				//list is empty (only possible after unlinking its only node)
+				elements.ptr[index].prev = LINKEDVECTORS_NONE;
+				elements.ptr[index].next = LINKEDVECTORS_NONE;
+				firstIndex = index;
+				lastIndex = index;
+				return;
+			}
+			i32 originalPrev = elements.ptr[before].prev;
+			elements.ptr[before].prev = index;
+			elements.ptr[index].next = before;
+			elements.ptr[index].prev = originalPrev;
+			if (originalPrev != LINKEDVECTORS_NONE)
+			{
+				elements.ptr[originalPrev].next = index;
+			}
+			else
+			{
+				firstIndex = index;
 			}
 		}
-		void Clear_Free()
+		void LinkAfter(i32 index, i32 after)
 		{
-			linkednode<T>* node = this->first;
-			while (node != NULL)
+			if (after == LINKEDVECTORS_NONE)
 			{
-				linkednode<T>* next = node->next;
-				this->allocator.Free(node);
-				node = next;
+				LinkBefore(index, LINKEDVECTORS_NONE);
+				return;
 			}
-			count = 0;
+			i32 originalNext = elements.ptr[after].next;
+			elements.ptr[after].next = index;
+			elements.ptr[index].prev = after;
+			elements.ptr[index].next = originalNext;
+			if (originalNext != LINKEDVECTORS_NONE)
+			{
+				elements.ptr[originalNext].prev = index;
+			}
+			else
+			{
+				lastIndex = index;
+			}
+		}
+
+		struct Iterator
+		{
+			linkedvectors<T>* list;
+			i32 current;
+			bool completed;
+
+			Iterator(linkedvectors<T>* list)
+			{
+				this->list = list;
+				current = list->firstIndex;
+				completed = false;
+			}
+
+			T* Next()
+			{
+				if (current == LINKEDVECTORS_NONE)
+				{
+					completed = true;
+					return NULL;
+				}
+				T* result = &list->elements.ptr[current].value;
+				current = list->elements.ptr[current].next;
+				return result;
+			}
+		};
+		inline Iterator GetIterator()
+		{
+			return Iterator(this);
 		}
 	};
-}
-#endif
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "Linxc.h"
+#include "string.hpp"
+#include "ByteStreamOps.hpp"
+
+#if WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+#if POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace io
+{
+    //A read only view of a whole file, mapped into memory instead of read. Pages are loaded from the OS file cache the first time they are touched,
+    //so mapping costs the same however large the file is and nothing is copied or allocated up front.
+    //data is always followed by a zero byte, so the view works as a null terminated string (which the Json tokenizer relies on).
+    //Writing to data crashes. The view stays valid until deinit, even if the file is deleted, but may change if the file is written to
+    struct MappedFile
+    {
+        u8 *data;
+        usize size;
+        //length of the whole mapping, including the terminating page if one was needed
+        usize mappedSize;
+        //whether the file had to be read into memory instead
+        bool copied;
+
+        inline MappedFile()
+        {
+            data = NULL;
+            size = 0;
+            mappedSize = 0;
+            copied = false;
+        }
+        inline bool IsValid()
+        {
+            return data != NULL;
+        }
+        //The contents as a string, with length including the terminator as io::ReadFile returns. The string must not be freed
+        inline string AsString()
+        {
+            string result = string();
+            result.buffer = (char*)data;
+            result.length = size + 1;
+            return result;
+        }
+        inline ByteStreamReader AsByteStreamReader()
+        {
+            return ByteStreamReader(data, size, 0);
+        }
+        inline void deinit()
+        {
+            if (data == NULL)
+            {
+                return;
+            }
+#if WINDOWS
+            if (copied)
+            {
+                VirtualFree(data, 0, MEM_RELEASE);
+            }
+            else if (mappedSize > 0)
+            {
+                UnmapViewOfFile(data);
+            }
+#else
+            if (mappedSize > 0)
+            {
+                munmap(data, mappedSize);
+            }
+#endif
+            data = NULL;
+            size = 0;
+            mappedSize = 0;
+        }
+    };
+
+    //Empty files cannot be mapped, and are given this instead.
+    //As a static local of an inline function it is one array shared by every translation unit
+    inline u8 *EmptyMappedFile()
+    {
+        static u8 emptyMappedFile[1] = { 0 };
+        return emptyMappedFile;
+    }
+
+    //Maps the file at path, returning a view that is not valid (IsValid returns false) if it could not be opened
+    inline MappedFile MapFile(const char *path)
+    {
+        MappedFile result = MappedFile();
+#if WINDOWS
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return result;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            return result;
+        }
+        usize size = (usize)fileSize.QuadPart;
+        if (size == 0)
+        {
+            CloseHandle(file);
+            result.data = EmptyMappedFile();
+            return result;
+        }
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        if (size % systemInfo.dwPageSize != 0)
+        {
+            //the rest of the last page reads as zeroes
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping != NULL)
+            {
+                result.data = (u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                //the view keeps the mapping alive
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            if (result.data != NULL)
+            {
+                result.size = size;
+                result.mappedSize = size;
+            }
+            return result;
+        }
+        //a file filling its last page exactly has no room for the terminator, and Windows cannot place a view in front of a page of our own,
+        //so these (one in every page size of files) are read instead
+        u8 *buffer = (u8*)VirtualAlloc(NULL, size + 1, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (buffer == NULL)
+        {
+            CloseHandle(file);
+            return result;
+        }
+        usize totalRead = 0;
+        while (totalRead < size)
+        {
+            usize remaining = size - totalRead;
+            DWORD read = 0;
+            if (!::ReadFile(file, buffer + totalRead, remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining, &read, NULL) || read == 0)
+            {
+                break;
+            }
+            totalRead += read;
+        }
+        CloseHandle(file);
+        buffer[totalRead] = 0;
+        result.data = buffer;
+        result.size = totalRead;
+        result.copied = true;
+        return result;
+#else
+        int file = open(path, O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            return result;
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0)
+        {
+            close(file);
+            return result;
+        }
+        usize size = (usize)status.st_size;
+        if (size == 0)
+        {
+            close(file);
+            result.data = EmptyMappedFile();
+            return result;
+        }
+        //reserve one page more than the file needs, then map the file over the start of it.
+        //Past the end of the file, the last page of the file reads as zeroes and so does the spare page, so there is always a terminator
+        usize pageSize = (usize)sysconf(_SC_PAGESIZE);
+        usize mappedSize = (size / pageSize + 1) * pageSize;
+        void *reserved = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+        {
+            close(file);
+            return result;
+        }
+        void *view = mmap(reserved, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, file, 0);
+        //the mapping keeps its own reference to the file
+        close(file);
+        if (view == MAP_FAILED)
+        {
+            munmap(reserved, mappedSize);
+            return result;
+        }
+        result.data = (u8*)view;
+        result.size = size;
+        result.mappedSize = mappedSize;
+        return result;
+#endif
+    }
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+#include "Linxc.h"
+#include "dirwalk.hpp"
+#include "jobsystem.hpp"
+
+//WalkDirectory spread over the job system, kept apart from dirwalk.hpp so that io.hpp does not depend on the job system
+
+namespace io
+{
+    //Each directory of a parallel walk is a job, which reads its entries and starts a job for each subdirectory
+    template<typename Visitor, typename Filter>
+    struct DirectoryWalkJob
+    {
+        threading::Job job;
+        threading::JobSystem *system;
+        threading::JobCounter *counter;
+        Visitor *visitor;
+        Filter *filter;
+        u32 depth;
+        DirectoryWalkPath path;
+#if POSIX
+        //the walk's root, opened once and kept open until the walk is done, and where this job's path begins relative to it
+        int rootDirectory;
+        usize relativeStart;
+#endif
+    };
+    template<typename Visitor, typename Filter>
+    void StartDirectoryWalkJob(DirectoryWalkJob<Visitor, Filter> *parent, const char *path, usize pathLength, u32 depth);
+
+    template<typename Visitor, typename Filter>
+    void RunDirectoryWalkJob(void *data)
+    {
+        DirectoryWalkJob<Visitor, Filter> *task = (DirectoryWalkJob<Visitor, Filter>*)data;
+        DirectoryWalkPath *path = &task->path;
+        usize baseLength = path->length;
+        auto visit = [&](const char *name, DirectoryEntryType type)
+        {
+            DirectoryEntry entry = path->Enter(name, type, task->depth);
+            if ((*task->filter)(entry))
+            {
+                (*task->visitor)(entry);
+                if (type == DirectoryEntryType_Directory)
+                {
+                    StartDirectoryWalkJob(task, path->buffer, path->length, task->depth + 1);
+                }
+            }
+            path->Truncate(baseLength);
+        };
+#if WINDOWS
+        ForEachDirectoryEntry(path, visit);
+#else
+        //subdirectories are opened relative to the root, so a root that is itself a symbolic link is followed once.
+        //O_NOFOLLOW then refuses a subdirectory that was swapped for a link after it was listed
+        int directory = task->rootDirectory;
+        if (task->depth > 0)
+        {
+            directory = openat(task->rootDirectory, path->buffer + task->relativeStart, O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+        }
+        if (directory >= 0)
+        {
+            u8 *buffer = (u8*)path->allocator.Allocate(DIRWALK_BUFFER_SIZE);
+            ForEachDirectoryEntry(directory, buffer, visit);
+            path->allocator.Free(buffer);
+            if (directory != task->rootDirectory)
+            {
+                close(directory);
+            }
+        }
+#endif
+        //the job lives in this allocation, which is safe to free as the job system has already read the job's counter
+        IAllocator allocator = path->allocator;
+        path->deinit();
+        allocator.Free(task);
+    }
+    template<typename Visitor, typename Filter>
+    void StartDirectoryWalkJob(DirectoryWalkJob<Visitor, Filter> *parent, const char *path, usize pathLength, u32 depth)
+    {
+        IAllocator allocator = GetCAllocator();
+        DirectoryWalkJob<Visitor, Filter> *task = (DirectoryWalkJob<Visitor, Filter>*)allocator.Allocate(sizeof(DirectoryWalkJob<Visitor, Filter>));
+        task->job = threading::Job(&RunDirectoryWalkJob<Visitor, Filter>, task);
+        task->system = parent->system;
+        task->counter = parent->counter;
+        task->visitor = parent->visitor;
+        task->filter = parent->filter;
+        task->depth = depth;
+        task->path = DirectoryWalkPath(allocator, path, pathLength);
+#if POSIX
+        task->rootDirectory = parent->rootDirectory;
+        task->relativeStart = parent->relativeStart;
+#endif
+        threading::RunJob(task->system, &task->job, task->counter);
+    }
+
+    //As WalkDirectory, with every directory read as a separate job so that the walk is spread over the job system's workers,
+    //which also lets many directory reads wait on the disk at once. Entries arrive in no particular order, and visitor and filter
+    //are called from several threads at once, so they must be thread safe. Job memory comes from the C allocator
+    template<typename Visitor, typename Filter>
+    bool ParallelWalkDirectory(threading::JobSystem *system, const char *root, Visitor visitor, Filter filter)
+    {
+#if WINDOWS
+        DWORD attributes = GetFileAttributesA(root);
+        if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            return false;
+        }
+#endif
+        threading::JobCounter counter;
+        DirectoryWalkJob<Visitor, Filter> rootInfo;
+        rootInfo.system = system;
+        rootInfo.counter = &counter;
+        rootInfo.visitor = &visitor;
+        rootInfo.filter = &filter;
+#if POSIX
+        //as with WalkDirectory, the root itself may be a symbolic link to a directory
+        rootInfo.rootDirectory = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (rootInfo.rootDirectory < 0)
+        {
+            return false;
+        }
+        //entry paths are the root's path, normalised as DirectoryWalkPath does, then a separator unless the root is "/"
+        DirectoryWalkPath rootPath = DirectoryWalkPath(GetCAllocator(), root, strlen(root));
+        rootInfo.relativeStart = rootPath.length;
+        if (rootPath.buffer[rootPath.length - 1] != '/')
+        {
+            rootInfo.relativeStart++;
+        }
+        rootPath.deinit();
+#endif
+        StartDirectoryWalkJob(&rootInfo, root, strlen(root), 0);
+        threading::WaitForCounter(system, &counter);
+#if POSIX
+        close(rootInfo.rootDirectory);
+#endif
+        return true;
+    }
+    template<typename Visitor>
+    bool ParallelWalkDirectory(threading::JobSystem *system, const char *root, Visitor visitor)
+    {
+        return ParallelWalkDirectory(system, root, visitor, &DirectoryWalkAcceptAll);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#pragma once
+#include "Linxc.h"
+#include "vector.hpp"
+#include "array.hpp"
+#include "jobsystem.hpp"
+
+//With a grain of 0, ranges are split into about this many chunks per worker so that stealing can even out uneven work
+#define PARALLELFOR_CHUNKS_PER_WORKER 8
+
+//Parallel loops over the job system. A range is split in half recursively until pieces are no larger than grain.
+//Each split hands its right half to the job system and keeps the left, so thieves always take the largest remaining piece,
+//and the thread that started the loop helps until every piece is done. Nothing is allocated; pending halves live on the stack.
+//Functors are called concurrently from several threads and must not write to shared state without synchronisation.
+
+namespace threading
+{
+    inline usize ParallelForGrain(JobSystem *system, usize length, usize grain)
+    {
+        if (grain > 0)
+        {
+            return grain;
+        }
+        usize chunks = (usize)system->workerCount * PARALLELFOR_CHUNKS_PER_WORKER;
+        grain = length / chunks;
+        return grain > 0 ? grain : 1;
+    }
+
+    template<typename RangeFunc>
+    struct ParallelForTask
+    {
+        JobSystem *system;
+        usize begin;
+        usize end;
+        usize grain;
+        RangeFunc *func;
+    };
+    template<typename RangeFunc>
+    void ParallelForRun(void *data)
+    {
+        ParallelForTask<RangeFunc> *task = (ParallelForTask<RangeFunc>*)data;
+        usize begin = task->begin;
+        usize end = task->end;
+        //halving means there can be no more splits than bits in usize
+        ParallelForTask<RangeFunc> children[sizeof(usize) * 8];
+        Job jobs[sizeof(usize) * 8];
+        usize spawned = 0;
+        JobCounter counter;
+        while (end - begin > task->grain)
+        {
+            usize middle = begin + (end - begin) / 2;
+            children[spawned] = *task;
+            children[spawned].begin = middle;
+            children[spawned].end = end;
+            jobs[spawned] = Job(&ParallelForRun<RangeFunc>, &children[spawned]);
+            RunJob(task->system, &jobs[spawned], &counter);
+            spawned++;
+            end = middle;
+        }
+        (*task->func)(begin, end);
+        if (spawned > 0)
+        {
+            WaitForCounter(task->system, &counter);
+        }
+    }
+
+    //Calls func(chunkBegin, chunkEnd) for chunks covering [begin, end), which suits loops the compiler can vectorise
+    template<typename RangeFunc>
+    void ParallelForRange(JobSystem *system, usize begin, usize end, usize grain, RangeFunc func)
+    {
+        if (end <= begin)
+        {
+            return;
+        }
+        ParallelForTask<RangeFunc> task;
+        task.system = system;
+        task.begin = begin;
+        task.end = end;
+        task.grain = ParallelForGrain(system, end - begin, grain);
+        task.func = &func;
+        ParallelForRun<RangeFunc>(&task);
+    }
+
+    template<typename Func>
+    struct ParallelForEachIndex
+    {
+        Func *func;
+        inline void operator()(usize begin, usize end)
+        {
+            for (usize i = begin; i < end; i++)
+            {
+                (*func)(i);
+            }
+        }
+    };
+    template<typename T, typename Func>
+    struct ParallelForEachItem
+    {
+        T *items;
+        Func *func;
+        inline void operator()(usize begin, usize end)
+        {
+            for (usize i = begin; i < end; i++)
+            {
+                (*func)(items[i]);
+            }
+        }
+    };
+
+    //Calls func(index) for every index in [begin, end). grain is the largest number of indices run as one job, or 0 to choose automatically
+    template<typename Func>
+    void ParallelFor(JobSystem *system, usize begin, usize end, usize grain, Func func)
+    {
+        ParallelForEachIndex<Func> rangeFunc;
+        rangeFunc.func = &func;
+        ParallelForRange(system, begin, end, grain, rangeFunc);
+    }
+    //Calls func(T &item) for every item
+    template<typename T, typename Func>
+    void ParallelFor(JobSystem *system, T *items, usize count, usize grain, Func func)
+    {
+        ParallelForEachItem<T, Func> rangeFunc;
+        rangeFunc.items = items;
+        rangeFunc.func = &func;
+        ParallelForRange(system, 0, count, grain, rangeFunc);
+    }
+    template<typename T, typename Func>
+    void ParallelFor(JobSystem *system, collections::vector<T> *vector, usize grain, Func func)
+    {
+        ParallelFor(system, vector->ptr, vector->count, grain, func);
+    }
+    template<typename T, typename Func>
+    void ParallelFor(JobSystem *system, collections::Array<T> *array, usize grain, Func func)
+    {
+        ParallelFor(system, array->data, array->length, grain, func);
+    }
+
+    template<typename T, typename RangeFold, typename Combine>
+    struct ParallelReduceTask
+    {
+        JobSystem *system;
+        usize begin;
+        usize end;
+        usize grain;
+        T identity;
+        RangeFold *fold;
+        Combine *combine;
+        T result;
+    };
+    template<typename T, typename RangeFold, typename Combine>
+    void ParallelReduceRun(void *data)
+    {
+        ParallelReduceTask<T, RangeFold, Combine> *task = (ParallelReduceTask<T, RangeFold, Combine>*)data;
+        usize begin = task->begin;
+        usize end = task->end;
+        ParallelReduceTask<T, RangeFold, Combine> children[sizeof(usize) * 8];
+        Job jobs[sizeof(usize) * 8];
+        usize spawned = 0;
+        JobCounter counter;
+        while (end - begin > task->grain)
+        {
+            usize middle = begin + (end - begin) / 2;
+            children[spawned] = *task;
+            children[spawned].begin = middle;
+            children[spawned].end = end;
+            jobs[spawned] = Job(&ParallelReduceRun<T, RangeFold, Combine>, &children[spawned]);
+            RunJob(task->system, &jobs[spawned], &counter);
+            spawned++;
+            end = middle;
+        }
+        T result = (*task->fold)(task->identity, begin, end);
+        if (spawned > 0)
+        {
+            WaitForCounter(task->system, &counter);
+            //later splits are further left, so combine from the last spawned outwards to keep the original order
+            for (usize i = spawned; i > 0; i--)
+            {
+                result = (*task->combine)(result, children[i - 1].result);
+            }
+        }
+        task->result = result;
+    }
+
+    //Folds [begin, end) in chunks with fold(accumulator, chunkBegin, chunkEnd) returning the new accumulator, each chunk starting from identity,
+    //then joins the chunk results with combine(left, right). combine must be associative but need not be commutative:
+    //the splits depend only on the range and grain, so results (including float rounding) are the same on every run
+    template<typename T, typename RangeFold, typename Combine>
+    T ParallelReduceRange(JobSystem *system, usize begin, usize end, usize grain, T identity, RangeFold fold, Combine combine)
+    {
+        if (end <= begin)
+        {
+            return identity;
+        }
+        ParallelReduceTask<T, RangeFold, Combine> task;
+        task.system = system;
+        task.begin = begin;
+        task.end = end;
+        task.grain = ParallelForGrain(system, end - begin, grain);
+        task.identity = identity;
+        task.fold = &fold;
+        task.combine = &combine;
+        ParallelReduceRun<T, RangeFold, Combine>(&task);
+        return task.result;
+    }
+
+    template<typename T, typename Fold>
+    struct ParallelReduceEachIndex
+    {
+        Fold *fold;
+        inline T operator()(T accumulator, usize begin, usize end)
+        {
+            for (usize i = begin; i < end; i++)
+            {
+                accumulator = (*fold)(accumulator, i);
+            }
+            return accumulator;
+        }
+    };
+    template<typename T, typename Item, typename Fold>
+    struct ParallelReduceEachItem
+    {
+        Item *items;
+        Fold *fold;
+        inline T operator()(T accumulator, usize begin, usize end)
+        {
+            for (usize i = begin; i < end; i++)
+            {
+                accumulator = (*fold)(accumulator, items[i]);
+            }
+            return accumulator;
+        }
+    };
+
+    //Reduces every index in [begin, end) with fold(accumulator, index), joining partial results with combine(left, right)
+    template<typename T, typename Fold, typename Combine>
+    T ParallelReduce(JobSystem *system, usize begin, usize end, usize grain, T identity, Fold fold, Combine combine)
+    {
+        ParallelReduceEachIndex<T, Fold> rangeFold;
+        rangeFold.fold = &fold;
+        return ParallelReduceRange(system, begin, end, grain, identity, rangeFold, combine);
+    }
+    //Reduces every item with fold(accumulator, Item &item)
+    template<typename T, typename Item, typename Fold, typename Combine>
+    T ParallelReduce(JobSystem *system, Item *items, usize count, usize grain, T identity, Fold fold, Combine combine)
+    {
+        ParallelReduceEachItem<T, Item, Fold> rangeFold;
+        rangeFold.items = items;
+        rangeFold.fold = &fold;
+        return ParallelReduceRange(system, 0, count, grain, identity, rangeFold, combine);
+    }
+    template<typename T, typename Item, typename Fold, typename Combine>
+    T ParallelReduce(JobSystem *system, collections::vector<Item> *vector, usize grain, T identity, Fold fold, Combine combine)
+    {
+        return ParallelReduce(system, vector->ptr, vector->count, grain, identity, fold, combine);
+    }
+    template<typename T, typename Item, typename Fold, typename Combine>
+    T ParallelReduce(JobSystem *system, collections::Array<Item> *array, usize grain, T identity, Fold fold, Combine combine)
+    {
+        return ParallelReduce(system, array->data, array->length, grain, identity, fold, combine);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,417 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "sorting.hpp"
+#include "threading.hpp"
+
+//Arrays shorter than this are sorted on the calling thread, as starting threads costs more than it saves
+#ifndef PARALLELSORT_MIN_LENGTH
+#define PARALLELSORT_MIN_LENGTH 65536
+#endif
+//Each thread is given at least this many items
+#define PARALLELSORT_MIN_CHUNK 16384
+#define PARALLELSORT_MAX_THREADS 256
+
+//Parallel merge sort. The array is split into one chunk per thread, each chunk is sorted with IntroSort (or TimSort when stable),
+//and then runs are merged pairwise between the array and a scratch buffer of the same length. Every merge round is shared
+//evenly between all threads by co-ranking: each thread finds where its slice of the output begins in both input runs with
+//a binary search and merges only that slice, so the final merge of two halves is as parallel as the first.
+//Threads are started for each phase and joined before the next, needing threading.hpp to be implemented (ASTRALCORE_THREADING_IMPL).
+
+template<typename T, typename Less>
+struct ParallelSortTask
+{
+    T *source;
+    T *destination;
+    usize arrayLength;
+    usize threadIndex;
+    usize threadCount;
+    //width in chunks of the runs being merged this round, 0 while sorting the chunks themselves
+    usize runWidth;
+    bool stable;
+    //when set, the task copies its chunk from source back into destination instead of merging
+    bool copyBack;
+    IAllocator scratchAllocator;
+    //the caller's comparator, which may be a capturing lambda that cannot be default constructed or assigned
+    Less *less;
+};
+
+inline usize ParallelSortChunkStart(usize arrayLength, usize chunkIndex, usize chunkCount)
+{
+    return (usize)(((u64)arrayLength * chunkIndex) / chunkCount);
+}
+
+//Returns how many items of A are among the first k items of the stable merge of A and B
+template<typename T, typename Less>
+usize ParallelSortCoRank(T *A, usize lengthA, T *B, usize lengthB, usize k, Less &less)
+{
+    usize low = k > lengthB ? k - lengthB : 0;
+    usize high = k < lengthA ? k : lengthA;
+    while (low < high)
+    {
+        usize middle = low + (high - low) / 2;
+        //items of B only come before equal items of A when strictly less, keeping the merge stable
+        if (less(B[k - middle - 1], A[middle]))
+        {
+            high = middle;
+        }
+        else low = middle + 1;
+    }
+    return low;
+}
+
+template<typename T, typename Less>
+void ParallelSortMergeSlice(T *A, T *endA, T *B, T *endB, T *destination, Less &less)
+{
+    while (A < endA && B < endB)
+    {
+        if (less(*B, *A))
+        {
+            *destination++ = *B++;
+        }
+        else *destination++ = *A++;
+    }
+    SortCopy(destination, A, endA - A);
+    SortCopy(destination + (endA - A), B, endB - B);
+}
+
+template<typename T, typename Less>
+THREAD_RESULT ParallelSortWorker(void *args)
+{
+    ParallelSortTask<T, Less> *task = (ParallelSortTask<T, Less>*)args;
+    usize chunkStart = ParallelSortChunkStart(task->arrayLength, task->threadIndex, task->threadCount);
+    usize chunkEnd = ParallelSortChunkStart(task->arrayLength, task->threadIndex + 1, task->threadCount);
+
+    if (task->copyBack)
+    {
+        SortCopy(task->destination + chunkStart, task->source + chunkStart, chunkEnd - chunkStart);
+    }
+    else if (task->runWidth == 0)
+    {
+        if (task->stable)
+        {
+            TimSort(task->source + chunkStart, chunkEnd - chunkStart, task->scratchAllocator, *task->less);
+        }
+        else IntroSort(task->source + chunkStart, chunkEnd - chunkStart, *task->less);
+    }
+    else
+    {
+        //chunk boundaries line up with run boundaries, so this thread's output lies within a single pair of runs
+        usize pairWidth = task->runWidth * 2;
+        usize firstChunk = (task->threadIndex / pairWidth) * pairWidth;
+        usize middleChunk = firstChunk + task->runWidth;
+        usize lastChunk = firstChunk + pairWidth;
+        if (middleChunk > task->threadCount)
+        {
+            middleChunk = task->threadCount;
+        }
+        if (lastChunk > task->threadCount)
+        {
+            lastChunk = task->threadCount;
+        }
+        usize pairStart = ParallelSortChunkStart(task->arrayLength, firstChunk, task->threadCount);
+        usize pairMiddle = ParallelSortChunkStart(task->arrayLength, middleChunk, task->threadCount);
+        usize pairEnd = ParallelSortChunkStart(task->arrayLength, lastChunk, task->threadCount);
+
+        T *A = task->source + pairStart;
+        usize lengthA = pairMiddle - pairStart;
+        T *B = task->source + pairMiddle;
+        usize lengthB = pairEnd - pairMiddle;
+
+        usize sliceStart = chunkStart - pairStart;
+        usize sliceEnd = chunkEnd - pairStart;
+        usize startA = ParallelSortCoRank(A, lengthA, B, lengthB, sliceStart, *task->less);
+        usize endA = ParallelSortCoRank(A, lengthA, B, lengthB, sliceEnd, *task->less);
+        ParallelSortMergeSlice(A + startA, A + endA, B + (sliceStart - startA), B + (sliceEnd - endA), task->destination + chunkStart, *task->less);
+    }
+    return (THREAD_RESULT)0;
+}
+
+//runs one phase on every thread, with the calling thread acting as the first
+template<typename T, typename Less>
+void ParallelSortRunPhase(ParallelSortTask<T, Less> *tasks, usize threadCount)
+{
+    threading::Thread threads[PARALLELSORT_MAX_THREADS];
+    for (usize i = 1; i < threadCount; i++)
+    {
+        threads[i] = threading::StartThread(&ParallelSortWorker<T, Less>, &tasks[i]);
+    }
+    ParallelSortWorker<T, Less>(&tasks[0]);
+    for (usize i = 1; i < threadCount; i++)
+    {
+        threading::JoinThread(threads[i]);
+    }
+}
+
+template<typename T, typename Less>
+void ParallelSortImpl(T* array, usize arrayLength, IAllocator scratchAllocator, Less less, i32 maxThreads, bool stable)
+{
+    usize threadCount = maxThreads > 0 ? (usize)maxThreads : (usize)threading::GetCPUCount();
+    if (threadCount > arrayLength / PARALLELSORT_MIN_CHUNK)
+    {
+        threadCount = arrayLength / PARALLELSORT_MIN_CHUNK;
+    }
+    if (threadCount > PARALLELSORT_MAX_THREADS)
+    {
+        threadCount = PARALLELSORT_MAX_THREADS;
+    }
+    if (arrayLength < PARALLELSORT_MIN_LENGTH || threadCount < 2)
+    {
+        if (stable)
+        {
+            TimSort(array, arrayLength, scratchAllocator, less);
+        }
+        else IntroSort(array, arrayLength, less);
+        return;
+    }
+
+    T *scratch = (T*)scratchAllocator.Allocate(sizeof(T) * arrayLength);
+    ParallelSortTask<T, Less> tasks[PARALLELSORT_MAX_THREADS];
+    for (usize i = 0; i < threadCount; i++)
+    {
+        tasks[i].source = array;
+        tasks[i].destination = scratch;
+        tasks[i].arrayLength = arrayLength;
+        tasks[i].threadIndex = i;
+        tasks[i].threadCount = threadCount;
+        tasks[i].runWidth = 0;
+        tasks[i].stable = stable;
+        tasks[i].copyBack = false;
+        tasks[i].scratchAllocator = scratchAllocator;
+        tasks[i].less = &less;
+    }
+    ParallelSortRunPhase(tasks, threadCount);
+
+    T *source = array;
+    T *destination = scratch;
+    for (usize runWidth = 1; runWidth < threadCount; runWidth *= 2)
+    {
+        for (usize i = 0; i < threadCount; i++)
+        {
+            tasks[i].source = source;
+            tasks[i].destination = destination;
+            tasks[i].runWidth = runWidth;
+        }
+        ParallelSortRunPhase(tasks, threadCount);
+        T *swap = source;
+        source = destination;
+        destination = swap;
+    }
+    if (source != array)
+    {
+        for (usize i = 0; i < threadCount; i++)
+        {
+            tasks[i].source = source;
+            tasks[i].destination = array;
+            tasks[i].copyBack = true;
+        }
+        ParallelSortRunPhase(tasks, threadCount);
+    }
+    scratchAllocator.FREEPTR(scratch);
+}
+
+//Sorts with up to maxThreads threads (or one per CPU if maxThreads is 0 or less). Allocates a scratch buffer of arrayLength items.
+//ParallelStableSort also allocates from scratchAllocator on the worker threads, so it must be thread safe (such as the CAllocator).
+//Every thread calls the same less, which may be a capturing lambda, so calling it must not modify shared state.
+template<typename T, typename Less>
+void ParallelSort(T* array, usize arrayLength, IAllocator scratchAllocator, Less less, i32 maxThreads)
+{
+    ParallelSortImpl(array, arrayLength, scratchAllocator, less, maxThreads, false);
+}
+template<typename T, typename Less>
+void ParallelSort(T* array, usize arrayLength, IAllocator scratchAllocator, Less less)
+{
+    ParallelSortImpl(array, arrayLength, scratchAllocator, less, 0, false);
+}
+template<typename T>
+void ParallelSort(T* array, usize arrayLength, IAllocator scratchAllocator)
+{
+    ParallelSortImpl(array, arrayLength, scratchAllocator, OperatorLess<T>(), 0, false);
+}
+
+//As ParallelSort, but equal items keep their original order
+template<typename T, typename Less>
+void ParallelStableSort(T* array, usize arrayLength, IAllocator scratchAllocator, Less less, i32 maxThreads)
+{
+    ParallelSortImpl(array, arrayLength, scratchAllocator, less, maxThreads, true);
+}
+template<typename T, typename Less>
+void ParallelStableSort(T* array, usize arrayLength, IAllocator scratchAllocator, Less less)
+{
+    ParallelSortImpl(array, arrayLength, scratchAllocator, less, 0, true);
+}
+template<typename T>
+void ParallelStableSort(T* array, usize arrayLength, IAllocator scratchAllocator)
+{
+    ParallelSortImpl(array, arrayLength, scratchAllocator, OperatorLess<T>(), 0, true);
+}
+
+template<typename T, typename KeyOf>
+struct ParallelRadixTask
+{
+    T *source;
+    T *destination;
+    usize arrayLength;
+    usize threadIndex;
+    usize threadCount;
+    usize shift;
+    //this thread's digit counts for its chunk, which are turned into where its items of each digit are written
+    usize *histogram;
+    //whether this phase scatters the chunk rather than counting it
+    bool scatter;
+    KeyOf *keyOf;
+};
+
+template<typename T, typename KeyOf>
+THREAD_RESULT ParallelRadixWorker(void *args)
+{
+    ParallelRadixTask<T, KeyOf> *task = (ParallelRadixTask<T, KeyOf>*)args;
+    usize chunkStart = ParallelSortChunkStart(task->arrayLength, task->threadIndex, task->threadCount);
+    usize chunkEnd = ParallelSortChunkStart(task->arrayLength, task->threadIndex + 1, task->threadCount);
+    KeyOf &keyOf = *task->keyOf;
+    usize shift = task->shift;
+    T *source = task->source;
+    usize *histogram = task->histogram;
+
+    if (!task->scatter)
+    {
+        memset(histogram, 0, sizeof(usize) * RADIX_BUCKETS);
+        for (usize i = chunkStart; i < chunkEnd; i++)
+        {
+            histogram[(keyOf(source[i]) >> shift) & (RADIX_BUCKETS - 1)]++;
+        }
+        return (THREAD_RESULT)0;
+    }
+    T *destination = task->destination;
+    usize prefetchEnd = chunkEnd > chunkStart + RADIX_PREFETCH_DISTANCE ? chunkEnd - RADIX_PREFETCH_DISTANCE : chunkStart;
+    usize i = chunkStart;
+    for (; i < prefetchEnd; i++)
+    {
+        SORT_PREFETCH_WRITE(destination + histogram[(keyOf(source[i + RADIX_PREFETCH_DISTANCE]) >> shift) & (RADIX_BUCKETS - 1)]);
+        usize digit = (keyOf(source[i]) >> shift) & (RADIX_BUCKETS - 1);
+        destination[histogram[digit]++] = source[i];
+    }
+    for (; i < chunkEnd; i++)
+    {
+        usize digit = (keyOf(source[i]) >> shift) & (RADIX_BUCKETS - 1);
+        destination[histogram[digit]++] = source[i];
+    }
+    return (THREAD_RESULT)0;
+}
+
+template<typename T, typename KeyOf>
+void ParallelRadixRunPhase(ParallelRadixTask<T, KeyOf> *tasks, usize threadCount)
+{
+    threading::Thread threads[PARALLELSORT_MAX_THREADS];
+    for (usize i = 1; i < threadCount; i++)
+    {
+        threads[i] = threading::StartThread(&ParallelRadixWorker<T, KeyOf>, &tasks[i]);
+    }
+    ParallelRadixWorker<T, KeyOf>(&tasks[0]);
+    for (usize i = 1; i < threadCount; i++)
+    {
+        threading::JoinThread(threads[i]);
+    }
+}
+
+//Stable LSD radix sort with up to maxThreads threads (or one per CPU if maxThreads is 0 or less), keyed as RadixSortByKey.
+//Every pass is split between the threads twice: each thread counts the digits of its chunk, then, once the counts are
+//summed digit by digit and thread by thread into write offsets, scatters its chunk. Chunks are scattered in order within
+//each digit, so the sort stays stable. Allocates a scratch buffer of arrayLength items and the histograms from scratchAllocator.
+template<typename T, typename KeyOf>
+void ParallelRadixSortByKey(T* array, usize arrayLength, IAllocator scratchAllocator, KeyOf keyOf, i32 maxThreads)
+{
+    typedef decltype(keyOf(*array)) KeyType;
+    const usize passesCount = (sizeof(KeyType) * 8 + RADIX_DIGIT_BITS - 1) / RADIX_DIGIT_BITS;
+
+    usize threadCount = maxThreads > 0 ? (usize)maxThreads : (usize)threading::GetCPUCount();
+    if (threadCount > arrayLength / PARALLELSORT_MIN_CHUNK)
+    {
+        threadCount = arrayLength / PARALLELSORT_MIN_CHUNK;
+    }
+    if (threadCount > PARALLELSORT_MAX_THREADS)
+    {
+        threadCount = PARALLELSORT_MAX_THREADS;
+    }
+    if (arrayLength < PARALLELSORT_MIN_LENGTH || threadCount < 2)
+    {
+        RadixSortByKey(array, arrayLength, scratchAllocator, keyOf);
+        return;
+    }
+
+    T *scratch = (T*)scratchAllocator.Allocate(sizeof(T) * arrayLength);
+    usize *histograms = (usize*)scratchAllocator.Allocate(sizeof(usize) * RADIX_BUCKETS * threadCount);
+    ParallelRadixTask<T, KeyOf> tasks[PARALLELSORT_MAX_THREADS];
+    for (usize i = 0; i < threadCount; i++)
+    {
+        tasks[i].destination = NULL;
+        tasks[i].arrayLength = arrayLength;
+        tasks[i].threadIndex = i;
+        tasks[i].threadCount = threadCount;
+        tasks[i].histogram = histograms + i * RADIX_BUCKETS;
+        tasks[i].keyOf = &keyOf;
+    }
+
+    T *source = array;
+    T *destination = scratch;
+    for (usize pass = 0; pass < passesCount; pass++)
+    {
+        for (usize i = 0; i < threadCount; i++)
+        {
+            tasks[i].source = source;
+            tasks[i].destination = destination;
+            tasks[i].shift = pass * RADIX_DIGIT_BITS;
+            tasks[i].scatter = false;
+        }
+        ParallelRadixRunPhase(tasks, threadCount);
+
+        //turn counts into starting offsets, ordered by digit and then by thread
+        usize offset = 0;
+        bool allOneDigit = false;
+        for (usize digit = 0; digit < RADIX_BUCKETS; digit++)
+        {
+            usize digitStart = offset;
+            for (usize i = 0; i < threadCount; i++)
+            {
+                usize count = tasks[i].histogram[digit];
+                tasks[i].histogram[digit] = offset;
+                offset += count;
+            }
+            if (offset - digitStart == arrayLength)
+            {
+                allOneDigit = true;
+                break;
+            }
+        }
+        if (allOneDigit)
+        {
+            continue;
+        }
+
+        for (usize i = 0; i < threadCount; i++)
+        {
+            tasks[i].scatter = true;
+        }
+        ParallelRadixRunPhase(tasks, threadCount);
+        T *swap = source;
+        source = destination;
+        destination = swap;
+    }
+    if (source != array)
+    {
+        SortCopy(array, source, arrayLength);
+    }
+    scratchAllocator.FREEPTR(histograms);
+    scratchAllocator.FREEPTR(scratch);
+}
+template<typename T, typename KeyOf>
+void ParallelRadixSortByKey(T* array, usize arrayLength, IAllocator scratchAllocator, KeyOf keyOf)
+{
+    ParallelRadixSortByKey(array, arrayLength, scratchAllocator, keyOf, 0);
+}
+//Sorts u32, u64, i32, i64, float or double arrays in ascending order, as RadixSort, with one thread per CPU
+template<typename T>
+void ParallelRadixSort(T* array, usize arrayLength, IAllocator scratchAllocator)
+{
+    ParallelRadixSortByKey(array, arrayLength, scratchAllocator, RadixIdentityKey<T>(), 0);
+}
\ No newline at end of file
@@ -0,0 +1,265 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "vector.hpp"
+#include "sorting.hpp"
+
+#define PRIORITYQUEUE_INVALID_HANDLE 0xFFFFFFFFu
+
+namespace collections
+{
+    //A d-ary min heap. With the default comparator, the smallest item is at the top of the queue.
+    //Arity 4 keeps the children of a node within one or two cache lines for small T and halves the depth of the tree
+    //compared to a binary heap, which makes Push cheaper and Pop about as expensive.
+    //Every pushed item is given a handle which stays valid until the item is popped or removed,
+    //allowing its priority to be changed in place (decrease-key) without searching the heap.
+    template<typename T, typename Less = OperatorLess<T>, usize Arity = 4>
+    struct priorityqueue
+    {
+        struct Entry
+        {
+            T value;
+            u32 handle;
+        };
+
+        IAllocator allocator;
+        collections::vector<Entry> heap;
+        //maps handles to their current position in the heap, PRIORITYQUEUE_INVALID_HANDLE if the handle is free
+        collections::vector<u32> handleToIndex;
+        collections::vector<u32> freeHandles;
+        Less less;
+        usize count;
+
+        priorityqueue()
+        {
+            allocator = IAllocator{};
+            heap = collections::vector<Entry>();
+            handleToIndex = collections::vector<u32>();
+            freeHandles = collections::vector<u32>();
+            less = Less();
+            count = 0;
+        }
+        priorityqueue(IAllocator myAllocator)
+        {
+            allocator = myAllocator;
+            heap = collections::vector<Entry>(myAllocator);
+            handleToIndex = collections::vector<u32>(myAllocator);
+            freeHandles = collections::vector<u32>(myAllocator);
+            less = Less();
+            count = 0;
+        }
+        priorityqueue(IAllocator myAllocator, Less comparator)
+        {
+            allocator = myAllocator;
+            heap = collections::vector<Entry>(myAllocator);
+            handleToIndex = collections::vector<u32>(myAllocator);
+            freeHandles = collections::vector<u32>(myAllocator);
+            less = comparator;
+            count = 0;
+        }
+        void deinit()
+        {
+            heap.deinit();
+            handleToIndex.deinit();
+            freeHandles.deinit();
+            count = 0;
+        }
+        void Clear()
+        {
+            heap.Clear();
+            handleToIndex.Clear();
+            freeHandles.Clear();
+            count = 0;
+        }
+        void EnsureCapacity(usize minCapacity)
+        {
+            heap.EnsureArrayCapacity(minCapacity);
+            handleToIndex.EnsureArrayCapacity(minCapacity);
+        }
+
+        u32 Push(T item)
+        {
+            u32 handle;
+            if (freeHandles.count > 0)
+            {
+                handle = freeHandles.Pop();
+            }
+            else
+            {
+                handle = (u32)handleToIndex.count;
+                handleToIndex.Add(PRIORITYQUEUE_INVALID_HANDLE);
+            }
+            Entry entry;
+            entry.value = item;
+            entry.handle = handle;
+            heap.Add(entry);
+            count = heap.count;
+            SiftUp(heap.count - 1);
+            return handle;
+        }
+        T *Peek()
+        {
+            if (count == 0)
+            {
+                return NULL;
+            }
+            return &heap.ptr[0].value;
+        }
+        u32 PeekHandle()
+        {
+            if (count == 0)
+            {
+                return PRIORITYQUEUE_INVALID_HANDLE;
+            }
+            return heap.ptr[0].handle;
+        }
+        T Pop()
+        {
+            if (count == 0)
+            {
+                return T{};
+            }
+            T result = heap.ptr[0].value;
+            RemoveAtIndex(0);
+            return result;
+        }
+        bool TryPop(T *result)
+        {
+            if (count == 0)
+            {
+                return false;
+            }
+            *result = heap.ptr[0].value;
+            RemoveAtIndex(0);
+            return true;
+        }
+
+        inline bool Contains(u32 handle)
+        {
+            return handle < handleToIndex.count && handleToIndex.ptr[handle] != PRIORITYQUEUE_INVALID_HANDLE;
+        }
+        T *Get(u32 handle)
+        {
+            if (!Contains(handle))
+            {
+                return NULL;
+            }
+            return &heap.ptr[handleToIndex.ptr[handle]].value;
+        }
+        //Replaces the value of a queued item with one that is ordered earlier or equal, moving it towards the top
+        void DecreaseKey(u32 handle, T newValue)
+        {
+            assert(Contains(handle));
+            usize index = handleToIndex.ptr[handle];
+            assert(!less(heap.ptr[index].value, newValue));
+            heap.ptr[index].value = newValue;
+            SiftUp(index);
+        }
+        //Replaces the value of a queued item, moving it in whichever direction the new value requires
+        void Update(u32 handle, T newValue)
+        {
+            assert(Contains(handle));
+            usize index = handleToIndex.ptr[handle];
+            bool movesUp = less(newValue, heap.ptr[index].value);
+            heap.ptr[index].value = newValue;
+            if (movesUp)
+            {
+                SiftUp(index);
+            }
+            else
+            {
+                SiftDown(index);
+            }
+        }
+        bool Remove(u32 handle)
+        {
+            if (!Contains(handle))
+            {
+                return false;
+            }
+            RemoveAtIndex(handleToIndex.ptr[handle]);
+            return true;
+        }
+
+        void RemoveAtIndex(usize index)
+        {
+            u32 handle = heap.ptr[index].handle;
+            handleToIndex.ptr[handle] = PRIORITYQUEUE_INVALID_HANDLE;
+            freeHandles.Add(handle);
+
+            usize last = heap.count - 1;
+            if (index != last)
+            {
+                bool movesUp = less(heap.ptr[last].value, heap.ptr[index].value);
+                heap.ptr[index] = heap.ptr[last];
+                heap.count = last;
+                if (movesUp)
+                {
+                    SiftUp(index);
+                }
+                else
+                {
+                    SiftDown(index);
+                }
+            }
+            else
+            {
+                heap.count = last;
+            }
+            count = heap.count;
+        }
+        //both sifts move a 'hole' through the heap and only write the moving entry once at the end
+        void SiftUp(usize index)
+        {
+            Entry moving = heap.ptr[index];
+            while (index > 0)
+            {
+                usize parent = (index - 1) / Arity;
+                if (!less(moving.value, heap.ptr[parent].value))
+                {
+                    break;
+                }
+                heap.ptr[index] = heap.ptr[parent];
+                handleToIndex.ptr[heap.ptr[index].handle] = (u32)index;
+                index = parent;
+            }
+            heap.ptr[index] = moving;
+            handleToIndex.ptr[moving.handle] = (u32)index;
+        }
+        void SiftDown(usize index)
+        {
+            Entry moving = heap.ptr[index];
+            usize heapCount = heap.count;
+            while (true)
+            {
+                usize firstChild = index * Arity + 1;
+                if (firstChild >= heapCount)
+                {
+                    break;
+                }
+                usize lastChild = firstChild + Arity;
+                if (lastChild > heapCount)
+                {
+                    lastChild = heapCount;
+                }
+                usize best = firstChild;
+                for (usize child = firstChild + 1; child < lastChild; child++)
+                {
+                    if (less(heap.ptr[child].value, heap.ptr[best].value))
+                    {
+                        best = child;
+                    }
+                }
+                if (!less(heap.ptr[best].value, moving.value))
+                {
+                    break;
+                }
+                heap.ptr[index] = heap.ptr[best];
+                handleToIndex.ptr[heap.ptr[index].handle] = (u32)index;
+                index = best;
+            }
+            heap.ptr[index] = moving;
+            handleToIndex.ptr[moving.handle] = (u32)index;
+        }
+    };
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "Linxc.h"
 #include "allocators.hpp"
+#include <string.h>
 
 namespace collections
 {
@@ -22,4 +22,52 @@ struct ScopeOnly
 #define CONCATIMPL(a, b) a ## b
 #define CONCAT(a, b) CONCATIMPL(a, b)
 #define Scope(type, instance) ScopeOnly<type> CONCAT(temp, __LINE__) = ScopeOnly<type>(&instance)
-#define ScopeVar(type, instance, name) ScopeOnly<type> name = ScopeOnly<type>(&instance)
\ No newline at end of file
+#define ScopeVar(type, instance, name) ScopeOnly<type> name = ScopeOnly<type>(&instance)
+
+//Holds a lock until the end of the scope. Works with any type that has Lock() and Unlock(), such as threading::Mutex and threading::TicketLock
+template<typename T>
+struct ScopeLockOnly
+{
+    T *lock;
+    ScopeLockOnly(T *lock)
+    {
+        this->lock = lock;
+        lock->Lock();
+    }
+    ~ScopeLockOnly()
+    {
+        lock->Unlock();
+    }
+};
+//Holds shared (read) access to a lock with ReadLock() and ReadUnlock(), such as threading::RWLock, until the end of the scope
+template<typename T>
+struct ScopeReadLockOnly
+{
+    T *lock;
+    ScopeReadLockOnly(T *lock)
+    {
+        this->lock = lock;
+        lock->ReadLock();
+    }
+    ~ScopeReadLockOnly()
+    {
+        lock->ReadUnlock();
+    }
+};
+template<typename T>
+struct ScopeWriteLockOnly
+{
+    T *lock;
+    ScopeWriteLockOnly(T *lock)
+    {
+        this->lock = lock;
+        lock->WriteLock();
+    }
+    ~ScopeWriteLockOnly()
+    {
+        lock->WriteUnlock();
+    }
+};
+#define ScopeLock(type, instance) ScopeLockOnly<type> CONCAT(tempLock, __LINE__)(&instance)
+#define ScopeReadLock(type, instance) ScopeReadLockOnly<type> CONCAT(tempLock, __LINE__)(&instance)
+#define ScopeWriteLock(type, instance) ScopeWriteLockOnly<type> CONCAT(tempLock, __LINE__)(&instance)
\ No newline at end of file
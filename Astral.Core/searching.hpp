@@ -0,0 +1,321 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "vector.hpp"
+#include "option.hpp"
+#include "sorting.hpp"
+#include "Maths/Util.hpp"
+
+#ifdef _MSC_VER
+#define SEARCH_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+#define SEARCH_PREFETCH(address) __builtin_prefetch((address), 0)
+#endif
+
+//Searches over arrays sorted by less, which must be the same ordering the array was sorted with.
+//All functions return indices, with arrayLength meaning 'past the end'.
+
+struct SearchRange
+{
+    usize start;
+    usize end;
+};
+
+//Index of the first element not ordered before value
+template<typename T, typename Less>
+usize LowerBound(T* array, usize arrayLength, T value, Less less)
+{
+    usize low = 0;
+    usize high = arrayLength;
+    while (low < high)
+    {
+        usize middle = low + (high - low) / 2;
+        if (less(array[middle], value))
+        {
+            low = middle + 1;
+        }
+        else high = middle;
+    }
+    return low;
+}
+//Index of the first element that value is ordered before
+template<typename T, typename Less>
+usize UpperBound(T* array, usize arrayLength, T value, Less less)
+{
+    usize low = 0;
+    usize high = arrayLength;
+    while (low < high)
+    {
+        usize middle = low + (high - low) / 2;
+        if (less(value, array[middle]))
+        {
+            high = middle;
+        }
+        else low = middle + 1;
+    }
+    return low;
+}
+//The range of elements equivalent to value, which is empty (start == end) at value's insertion point if there are none
+template<typename T, typename Less>
+SearchRange EqualRange(T* array, usize arrayLength, T value, Less less)
+{
+    usize low = 0;
+    usize high = arrayLength;
+    while (low < high)
+    {
+        usize middle = low + (high - low) / 2;
+        if (less(array[middle], value))
+        {
+            low = middle + 1;
+        }
+        else if (less(value, array[middle]))
+        {
+            high = middle;
+        }
+        else
+        {
+            //found an equal element, the two bounds can now be searched for within the narrowed range independently
+            SearchRange result;
+            result.start = low + LowerBound(array + low, middle - low, value, less);
+            result.end = middle + 1 + UpperBound(array + middle + 1, high - (middle + 1), value, less);
+            return result;
+        }
+    }
+    SearchRange result;
+    result.start = low;
+    result.end = low;
+    return result;
+}
+//Index of an element equivalent to value, if any
+template<typename T, typename Less>
+option<usize> BinarySearch(T* array, usize arrayLength, T value, Less less)
+{
+    usize index = LowerBound(array, arrayLength, value, less);
+    if (index < arrayLength && !less(value, array[index]))
+    {
+        return option<usize>(index);
+    }
+    return option<usize>();
+}
+
+//Branchless variants. The loop always runs log2(n) times and the comparison only selects the next base pointer,
+//which compiles to a conditional move, so there are no mispredicted branches on random queries.
+//The two possible next midpoints are prefetched, hiding part of the cache miss latency on arrays larger than the cache.
+//These are faster than LowerBound/UpperBound whenever queries are unpredictable.
+template<typename T, typename Less>
+usize LowerBoundBranchless(T* array, usize arrayLength, T value, Less less)
+{
+    if (arrayLength == 0)
+    {
+        return 0;
+    }
+    T *base = array;
+    usize length = arrayLength;
+    while (length > 1)
+    {
+        usize half = length / 2;
+        SEARCH_PREFETCH(base + half / 2);
+        SEARCH_PREFETCH(base + half + half / 2);
+        base = less(base[half], value) ? base + half : base;
+        length -= half;
+    }
+    return (base - array) + (usize)less(*base, value);
+}
+template<typename T, typename Less>
+usize UpperBoundBranchless(T* array, usize arrayLength, T value, Less less)
+{
+    if (arrayLength == 0)
+    {
+        return 0;
+    }
+    T *base = array;
+    usize length = arrayLength;
+    while (length > 1)
+    {
+        usize half = length / 2;
+        SEARCH_PREFETCH(base + half / 2);
+        SEARCH_PREFETCH(base + half + half / 2);
+        base = less(value, base[half]) ? base : base + half;
+        length -= half;
+    }
+    return (base - array) + (usize)!less(value, *base);
+}
+
+template<typename T>
+usize LowerBound(T* array, usize arrayLength, T value)
+{
+    return LowerBound(array, arrayLength, value, OperatorLess<T>());
+}
+template<typename T>
+usize UpperBound(T* array, usize arrayLength, T value)
+{
+    return UpperBound(array, arrayLength, value, OperatorLess<T>());
+}
+template<typename T>
+SearchRange EqualRange(T* array, usize arrayLength, T value)
+{
+    return EqualRange(array, arrayLength, value, OperatorLess<T>());
+}
+template<typename T>
+option<usize> BinarySearch(T* array, usize arrayLength, T value)
+{
+    return BinarySearch(array, arrayLength, value, OperatorLess<T>());
+}
+template<typename T>
+usize LowerBoundBranchless(T* array, usize arrayLength, T value)
+{
+    return LowerBoundBranchless(array, arrayLength, value, OperatorLess<T>());
+}
+template<typename T>
+usize UpperBoundBranchless(T* array, usize arrayLength, T value)
+{
+    return UpperBoundBranchless(array, arrayLength, value, OperatorLess<T>());
+}
+
+template<typename T, typename Less>
+usize LowerBound(collections::vector<T> *vector, T value, Less less)
+{
+    return LowerBound(vector->ptr, vector->count, value, less);
+}
+template<typename T, typename Less>
+usize UpperBound(collections::vector<T> *vector, T value, Less less)
+{
+    return UpperBound(vector->ptr, vector->count, value, less);
+}
+template<typename T, typename Less>
+SearchRange EqualRange(collections::vector<T> *vector, T value, Less less)
+{
+    return EqualRange(vector->ptr, vector->count, value, less);
+}
+template<typename T, typename Less>
+option<usize> BinarySearch(collections::vector<T> *vector, T value, Less less)
+{
+    return BinarySearch(vector->ptr, vector->count, value, less);
+}
+template<typename T>
+usize LowerBound(collections::vector<T> *vector, T value)
+{
+    return LowerBound(vector->ptr, vector->count, value, OperatorLess<T>());
+}
+template<typename T>
+usize UpperBound(collections::vector<T> *vector, T value)
+{
+    return UpperBound(vector->ptr, vector->count, value, OperatorLess<T>());
+}
+template<typename T>
+SearchRange EqualRange(collections::vector<T> *vector, T value)
+{
+    return EqualRange(vector->ptr, vector->count, value, OperatorLess<T>());
+}
+template<typename T>
+option<usize> BinarySearch(collections::vector<T> *vector, T value)
+{
+    return BinarySearch(vector->ptr, vector->count, value, OperatorLess<T>());
+}
+
+namespace collections
+{
+    //A read only copy of a sorted array stored in Eytzinger (BFS/heap) order: the root at index 1 and the children of k at 2k and 2k+1.
+    //Searches walk down the array from the front, so the first levels of every search share the same few cache lines
+    //and each next level's candidates are adjacent, which lets a whole cache line of descendants be prefetched several levels ahead.
+    //For large lookup tables this beats binary search on the sorted array by several times.
+    //Slots are 1 based, with slot 0 unused and returned from lookups to mean 'none'.
+    template<typename T, typename Less = OperatorLess<T>>
+    struct eytzingerarray
+    {
+        IAllocator allocator;
+        T *ptr;
+        usize count;
+        Less less;
+
+        eytzingerarray()
+        {
+            allocator = IAllocator{};
+            ptr = NULL;
+            count = 0;
+            less = Less();
+        }
+        //sorted must already be ordered by comparator
+        eytzingerarray(IAllocator myAllocator, T *sorted, usize sortedLength, Less comparator)
+        {
+            allocator = myAllocator;
+            ptr = (T*)allocator.Allocate(sizeof(T) * (sortedLength + 1));
+            count = sortedLength;
+            less = comparator;
+            Build(sorted, 0, 1);
+        }
+        eytzingerarray(IAllocator myAllocator, T *sorted, usize sortedLength)
+        {
+            allocator = myAllocator;
+            ptr = (T*)allocator.Allocate(sizeof(T) * (sortedLength + 1));
+            count = sortedLength;
+            less = Less();
+            Build(sorted, 0, 1);
+        }
+        void deinit()
+        {
+            if (ptr != NULL)
+            {
+                allocator.FREEPTR(ptr);
+            }
+            count = 0;
+        }
+
+        //fills the tree with an in order traversal, returning the next index of sorted to read
+        usize Build(T *sorted, usize sortedIndex, usize slot)
+        {
+            if (slot <= count)
+            {
+                sortedIndex = Build(sorted, sortedIndex, slot * 2);
+                ptr[slot] = sorted[sortedIndex++];
+                sortedIndex = Build(sorted, sortedIndex, slot * 2 + 1);
+            }
+            return sortedIndex;
+        }
+
+        //Slot of the first element not ordered before value, or 0 if there is none
+        usize LowerBound(T value)
+        {
+            //descendants this many levels down from slot k begin at k * prefetchStride, and fill one cache line
+            const usize prefetchStride = sizeof(T) >= 64 ? 1 : (sizeof(T) > 32 ? 2 : (sizeof(T) > 16 ? 4 : (sizeof(T) > 8 ? 8 : 16)));
+            usize slot = 1;
+            while (slot <= count)
+            {
+                SEARCH_PREFETCH((const char*)ptr + slot * prefetchStride * sizeof(T));
+                slot = slot * 2 + (usize)less(ptr[slot], value);
+            }
+            //the path went right every time after the answer, undo those steps and the final left step
+            return slot >> (Maths::CountTrailingZeros64(~(u64)slot) + 1);
+        }
+        //Slot of the first element that value is ordered before, or 0 if there is none
+        usize UpperBound(T value)
+        {
+            const usize prefetchStride = sizeof(T) >= 64 ? 1 : (sizeof(T) > 32 ? 2 : (sizeof(T) > 16 ? 4 : (sizeof(T) > 8 ? 8 : 16)));
+            usize slot = 1;
+            while (slot <= count)
+            {
+                SEARCH_PREFETCH((const char*)ptr + slot * prefetchStride * sizeof(T));
+                slot = slot * 2 + (usize)!less(value, ptr[slot]);
+            }
+            return slot >> (Maths::CountTrailingZeros64(~(u64)slot) + 1);
+        }
+        //The element equivalent to value, or NULL
+        T *Find(T value)
+        {
+            usize slot = LowerBound(value);
+            if (slot != 0 && !less(value, ptr[slot]))
+            {
+                return &ptr[slot];
+            }
+            return NULL;
+        }
+        inline bool Contains(T value)
+        {
+            return Find(value) != NULL;
+        }
+        inline T *Get(usize slot)
+        {
+            return slot == 0 ? NULL : &ptr[slot];
+        }
+    };
+}
\ No newline at end of file
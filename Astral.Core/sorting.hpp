@@ -3,6 +3,9 @@
 #include "array.hpp"
 #include "assert.h"
 #include "Maths/Util.hpp"
+#include "Maths/simd.h"
+#include <string.h>
+#include <math.h>
 
 #define SORT_SUBARRAY_SIZE 32
 
@@ -13,67 +16,59 @@ void InsertionSort(T* array, usize left, usize right, i8(*comparator)(T&, T&))
     { 
         T temp = array[i]; 
         i64 j = i - 1; 
-        while (j >= left && comparator(array[j], temp) > 0) 
+        //left must be compared as signed, otherwise j >= left is always true once j reaches -1
+        while (j >= (i64)left && comparator(array[j], temp) > 0) 
         { 
             array[j + 1] = array[j]; 
             j--;
-            if (j == -1) //WHY IS THIS NEEDED?
-            {
-                break;
-            }
         }
         array[j + 1] = temp; 
     }
 }
 
+//Merges the sorted ranges [left, mid] and [mid + 1, right]. Only the left range is copied out, into a single temporary buffer.
+//TimSort does not use this, it merges through one scratch buffer that is reused for the whole sort
 template<typename T>
 void MergeSort(T* array, i64 left, i64 mid, i64 right, i8(*comparator)(T&, T&))
 {
     i64 leftArrLength = mid - left + 1;
-    i64 rightArrLength = right - mid;
-    //Original array is broken into two parts: left and right subarray
     collections::Array<T> leftArr = collections::Array<T>(GetCAllocator(), leftArrLength);
-    collections::Array<T> rightArr = collections::Array<T>(GetCAllocator(), rightArrLength);
-
-    //Fill in the subarrays
     for (i64 index = 0; index < leftArrLength; index++)
         leftArr.data[index] = array[left + index];
-    for (i64 index = 0; index < rightArrLength; index++)
-        rightArr.data[index] = array[mid + 1 + index];
 
-    //Merge the subarrays after comparing
-    int i = 0, j = 0, k = left;
-    while (i < leftArrLength && j < rightArrLength)
+    //the write position can never overtake the unread part of the right range, so it is merged in place
+    i64 i = 0, j = mid + 1, k = left;
+    while (i < leftArrLength && j <= right)
     {
-        if (comparator(leftArr.data[i], rightArr.data[j]) <= 0)//(leftArr[i]?.CompareTo(rightArr[j]) ?? 0) <= 0)
+        if (comparator(leftArr.data[i], array[j]) <= 0)
             array[k++] = leftArr.data[i++];
         else
-            array[k++] = rightArr.data[j++];
+            array[k++] = array[j++];
     }
 
-    //Copy any remaining elements left, if any
+    //Copy any remaining elements left, if any. Leftover right elements are already in place
     while (i < leftArrLength)
         array[k++] = leftArr.data[i++];
-    while (j < rightArrLength)
-        array[k++] = rightArr.data[j++];
 
     leftArr.deinit();
-    rightArr.deinit();
 }
 
+//Scalar bitonic sorting network. arrayLength must be a power of two.
+//float and i32 arrays have overloads further below that use a vectorised network
 template<typename T>
 void BitonicSort(T* array, usize arrayLength)
 {
+    assert((arrayLength & (arrayLength - 1)) == 0);
     //k: stage
     //j: pass
     //i: array index
-    for (i32 k = 2; k <= arrayLength / 2; k *= 2)
+    for (usize k = 2; k <= arrayLength; k *= 2)
     {
-        for (i32 j = k / 2; j > 0; j /= 2)
+        for (usize j = k / 2; j > 0; j /= 2)
         {
-            for (i32 i = 0; i < arrayLength; i++) 
+            for (usize i = 0; i < arrayLength; i++) 
             {
-                i32 ij = i ^ j;
+                usize ij = i ^ j;
 
                 if (ij > i) 
                 {
@@ -101,56 +96,1851 @@ void BitonicSort(T* array, usize arrayLength)
     }
 }
 
-//32 is used as a compromize between fast Insertion Sorts and fewer merges
-//A power of two is used for the most efficiency, since the resulting arrays will also be powers of two (unless the array length isn't, then the last one will just be the remainder.)
-//Insertion Sort is very efficient with small arrays, but not with large arrays.  A value of 64 or higher results in slower initial sorting, but faster merging
-//A value of 16 or lower results in faster initial sorting, but slower merging since more merging has to be done
-#define SUBARRAY_SIZE 32
+#define IMPL_COMPARATORS(nameOfType, compareVar) inline bool operator<(nameOfType &other) { return this->compareVar < other.compareVar;} inline bool operator>(nameOfType &other) { return this->compareVar > other.compareVar;} inline bool operator<=(nameOfType &other) { return this->compareVar <= other.compareVar;} inline bool operator>=(nameOfType &other) { return this->compareVar >= other.compareVar;} inline bool operator==(nameOfType &other) { return this->compareVar == other.compareVar;} inline bool operator!=(nameOfType &other) { return this->compareVar != other.compareVar;}
 
-template<typename T> 
-void TimSort(T* array, usize arrayLength, i8(*comparator)(T&, T&))
+template<typename T>
+i8 OperatorBasedComparator(T& A, T& B)
 {
-    if (arrayLength < 2)
-        return;
+    if (A < B)
+    {
+        return -1;
+    }
+    if (A > B)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+//Functor comparator that is inlined at the call site instead of being called through a function pointer.
+//Returns true if A should be ordered before B
+template<typename T>
+struct OperatorLess
+{
+    inline bool operator()(T& A, T& B)
+    {
+        return A < B;
+    }
+};
+template<typename T>
+struct OperatorGreater
+{
+    inline bool operator()(T& A, T& B)
+    {
+        return B < A;
+    }
+};
 
-    //Sort the subarrays using insertion sort
-    for (i64 i = 0; i < arrayLength; i += SUBARRAY_SIZE)
-        InsertionSort<T>(array, i, AC_MIN(i + SUBARRAY_SIZE - 1, arrayLength - 1), comparator);
+//Adapts i8(*)(T&, T&) comparator functions to the functor comparators taken by the sorting functions
+template<typename T>
+struct FunctionComparatorLess
+{
+    i8(*comparator)(T&, T&);
 
-    if (arrayLength <= SUBARRAY_SIZE)
-        return;
+    inline FunctionComparatorLess(i8(*comparator)(T&, T&))
+    {
+        this->comparator = comparator;
+    }
+    inline bool operator()(T& A, T& B)
+    {
+        return comparator(A, B) < 0;
+    }
+};
+
+#ifdef USE_SSE
+//Vectorised sorting networks for blocks of up to 32 i32s, held in 1 to 8 SSE registers.
+//Registers are first sorted with a min/max network across registers followed by a 4x4 transpose (or an in-register network
+//for single registers), then merged with bitonic merges whose last two steps are done by shuffling within each register.
+//Only integers are sorted this way, as min and max are exact for them. _mm_min_ps and _mm_max_ps return their second operand
+//for NaNs and for -0.0 against 0.0, which would drop some values and duplicate others, so BitonicSort(float) sorts integer keys instead
+struct SimdSortI32Traits
+{
+    typedef i32 Type;
+    //shuffles work on float registers, integers are reinterpreted in place for min/max
+#if defined(__SSE4_1__) || defined(__AVX__)
+    static inline __m128 Min(__m128 A, __m128 B) { return _mm_castsi128_ps(_mm_min_epi32(_mm_castps_si128(A), _mm_castps_si128(B))); }
+    static inline __m128 Max(__m128 A, __m128 B) { return _mm_castsi128_ps(_mm_max_epi32(_mm_castps_si128(A), _mm_castps_si128(B))); }
+#else
+    static inline __m128 Min(__m128 A, __m128 B)
+    {
+        __m128 greater = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_castps_si128(A), _mm_castps_si128(B)));
+        return _mm_or_ps(_mm_and_ps(greater, B), _mm_andnot_ps(greater, A));
+    }
+    static inline __m128 Max(__m128 A, __m128 B)
+    {
+        __m128 greater = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_castps_si128(A), _mm_castps_si128(B)));
+        return _mm_or_ps(_mm_and_ps(greater, A), _mm_andnot_ps(greater, B));
+    }
+#endif
+    static inline i32 Largest() { return AC_I32Max; }
+};
+
+template<typename Traits>
+struct SimdSortingNetwork
+{
+    typedef typename Traits::Type Type;
+
+    static inline void CompareSwap(__m128 &A, __m128 &B)
+    {
+        __m128 low = Traits::Min(A, B);
+        B = Traits::Max(A, B);
+        A = low;
+    }
+    static inline __m128 Reverse(__m128 value)
+    {
+        return _mm_shuffle_ps(value, value, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+    //sorts a register holding a bitonic sequence
+    static inline __m128 BitonicMerge4(__m128 value)
+    {
+        //distance 2
+        __m128 swapped = _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128 low = Traits::Min(value, swapped);
+        __m128 high = Traits::Max(value, swapped);
+        value = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 2, 1, 0));
+        //distance 1
+        swapped = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+        low = Traits::Min(value, swapped);
+        high = Traits::Max(value, swapped);
+        __m128 mixed = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 2, 0));
+        return _mm_shuffle_ps(mixed, mixed, _MM_SHUFFLE(3, 1, 2, 0));
+    }
+    static inline __m128 Sort4(__m128 value)
+    {
+        //sort lanes 0-1 ascending and 2-3 descending, making the register bitonic
+        __m128 swapped = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 low = Traits::Min(value, swapped);
+        __m128 high = Traits::Max(value, swapped);
+        __m128 mixed = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 1, 3, 0));
+        return BitonicMerge4(_mm_shuffle_ps(mixed, mixed, _MM_SHUFFLE(1, 3, 2, 0)));
+    }
+    //sorts 4 registers into 4 individually sorted registers
+    static inline void SortColumns4(__m128 *registers)
+    {
+        CompareSwap(registers[0], registers[1]);
+        CompareSwap(registers[2], registers[3]);
+        CompareSwap(registers[0], registers[2]);
+        CompareSwap(registers[1], registers[3]);
+        CompareSwap(registers[1], registers[2]);
+        _MM_TRANSPOSE4_PS(registers[0], registers[1], registers[2], registers[3]);
+    }
+    //sorts registersCount registers that together hold a bitonic sequence
+    static inline void BitonicMergeRegisters(__m128 *registers, usize registersCount)
+    {
+        if (registersCount == 1)
+        {
+            registers[0] = BitonicMerge4(registers[0]);
+            return;
+        }
+        usize half = registersCount / 2;
+        for (usize i = 0; i < half; i++)
+        {
+            CompareSwap(registers[i], registers[i + half]);
+        }
+        BitonicMergeRegisters(registers, half);
+        BitonicMergeRegisters(registers + half, half);
+    }
+    //merges two sorted halves of registersCount registers. reversing the second half makes the whole sequence bitonic
+    static inline void MergeHalves(__m128 *registers, usize registersCount)
+    {
+        usize half = registersCount / 2;
+        for (usize i = 0; i < half / 2; i++)
+        {
+            __m128 temp = registers[half + i];
+            registers[half + i] = registers[registersCount - 1 - i];
+            registers[registersCount - 1 - i] = temp;
+        }
+        for (usize i = half; i < registersCount; i++)
+        {
+            registers[i] = Reverse(registers[i]);
+        }
+        BitonicMergeRegisters(registers, registersCount);
+    }
+    //sorts a block of 4, 8, 16 or 32 elements in place
+    static void SortBlock(__m128 *registers, usize registersCount)
+    {
+        if (registersCount < 4)
+        {
+            for (usize i = 0; i < registersCount; i++)
+            {
+                registers[i] = Sort4(registers[i]);
+            }
+        }
+        else
+        {
+            for (usize i = 0; i < registersCount; i += 4)
+            {
+                SortColumns4(registers + i);
+            }
+        }
+        for (usize width = 2; width <= registersCount; width *= 2)
+        {
+            for (usize i = 0; i < registersCount; i += width)
+            {
+                MergeHalves(registers + i, width);
+            }
+        }
+    }
+    //sorts up to 32 elements by padding them to the next block size with the largest value
+    static void Sort(Type *array, usize arrayLength)
+    {
+        assert(arrayLength <= 32);
+        if (arrayLength < 2)
+        {
+            return;
+        }
+        usize blockSize = 4;
+        while (blockSize < arrayLength)
+        {
+            blockSize *= 2;
+        }
+        Type padded[32];
+        memcpy(padded, array, sizeof(Type) * arrayLength);
+        for (usize i = arrayLength; i < blockSize; i++)
+        {
+            padded[i] = Traits::Largest();
+        }
+        __m128 registers[8];
+        usize registersCount = blockSize / 4;
+        for (usize i = 0; i < registersCount; i++)
+        {
+            registers[i] = _mm_loadu_ps((float*)(padded + i * 4));
+        }
+        SortBlock(registers, registersCount);
+        for (usize i = 0; i < registersCount; i++)
+        {
+            _mm_storeu_ps((float*)(padded + i * 4), registers[i]);
+        }
+        memcpy(array, padded, sizeof(Type) * arrayLength);
+    }
+};
+#endif
+
+#ifdef USE_AVX2
+//The i32 network with 8 lanes per AVX2 register, sorting blocks of 8, 16 or 32 elements in 1 to 4 registers.
+//Each register is sorted by a bitonic network across its lanes, then registers are merged as in SimdSortingNetwork
+struct SimdSortI32x8Network
+{
+    //whether a lane keeps the larger of itself and the lane distance away, in the step of a bitonic sort that builds sorted runs of runLength
+    static constexpr bool TakesMax(int lane, int distance, int runLength)
+    {
+        return ((lane & distance) != 0) == ((lane & runLength) == 0);
+    }
+    static constexpr int TakesMaxMask(int distance, int runLength)
+    {
+        return TakesMax(0, distance, runLength) | (TakesMax(1, distance, runLength) << 1) | (TakesMax(2, distance, runLength) << 2) | (TakesMax(3, distance, runLength) << 3)
+            | (TakesMax(4, distance, runLength) << 4) | (TakesMax(5, distance, runLength) << 5) | (TakesMax(6, distance, runLength) << 6) | (TakesMax(7, distance, runLength) << 7);
+    }
+    //compares every lane with the lane distance away. A runLength of 8 sorts every pair ascending
+    template<int distance, int runLength>
+    static inline __m256i Step(__m256i value)
+    {
+        __m256i partners;
+        if (distance == 1)
+        {
+            partners = _mm256_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        else if (distance == 2)
+        {
+            partners = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+        }
+        else
+        {
+            partners = _mm256_permute2x128_si256(value, value, 1);
+        }
+        __m256i low = _mm256_min_epi32(value, partners);
+        __m256i high = _mm256_max_epi32(value, partners);
+        return _mm256_blend_epi32(low, high, TakesMaxMask(distance, runLength));
+    }
+    //sorts a register holding a bitonic sequence
+    static inline __m256i BitonicMerge8(__m256i value)
+    {
+        value = Step<4, 8>(value);
+        value = Step<2, 8>(value);
+        return Step<1, 8>(value);
+    }
+    static inline __m256i Sort8(__m256i value)
+    {
+        value = Step<1, 2>(value);
+        value = Step<2, 4>(value);
+        value = Step<1, 4>(value);
+        return BitonicMerge8(value);
+    }
+    static inline void CompareSwap(__m256i &A, __m256i &B)
+    {
+        __m256i low = _mm256_min_epi32(A, B);
+        B = _mm256_max_epi32(A, B);
+        A = low;
+    }
+    static inline __m256i Reverse(__m256i value)
+    {
+        return _mm256_permutevar8x32_epi32(value, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+    //sorts registersCount registers that together hold a bitonic sequence
+    static inline void BitonicMergeRegisters(__m256i *registers, usize registersCount)
+    {
+        if (registersCount == 1)
+        {
+            registers[0] = BitonicMerge8(registers[0]);
+            return;
+        }
+        usize half = registersCount / 2;
+        for (usize i = 0; i < half; i++)
+        {
+            CompareSwap(registers[i], registers[i + half]);
+        }
+        BitonicMergeRegisters(registers, half);
+        BitonicMergeRegisters(registers + half, half);
+    }
+    //merges two sorted halves of registersCount registers. reversing the second half makes the whole sequence bitonic
+    static inline void MergeHalves(__m256i *registers, usize registersCount)
+    {
+        usize half = registersCount / 2;
+        for (usize i = 0; i < half / 2; i++)
+        {
+            __m256i temp = registers[half + i];
+            registers[half + i] = registers[registersCount - 1 - i];
+            registers[registersCount - 1 - i] = temp;
+        }
+        for (usize i = half; i < registersCount; i++)
+        {
+            registers[i] = Reverse(registers[i]);
+        }
+        BitonicMergeRegisters(registers, registersCount);
+    }
+    //sorts up to 32 elements by padding them to the next block size with the largest value
+    static void Sort(i32 *array, usize arrayLength)
+    {
+        assert(arrayLength <= 32);
+        if (arrayLength < 2)
+        {
+            return;
+        }
+        usize blockSize = 8;
+        while (blockSize < arrayLength)
+        {
+            blockSize *= 2;
+        }
+        i32 padded[32];
+        memcpy(padded, array, sizeof(i32) * arrayLength);
+        for (usize i = arrayLength; i < blockSize; i++)
+        {
+            padded[i] = AC_I32Max;
+        }
+        __m256i registers[4];
+        usize registersCount = blockSize / 8;
+        for (usize i = 0; i < registersCount; i++)
+        {
+            registers[i] = Sort8(_mm256_loadu_si256((__m256i*)(padded + i * 8)));
+        }
+        for (usize width = 2; width <= registersCount; width *= 2)
+        {
+            for (usize i = 0; i < registersCount; i += width)
+            {
+                MergeHalves(registers + i, width);
+            }
+        }
+        for (usize i = 0; i < registersCount; i++)
+        {
+            _mm256_storeu_si256((__m256i*)(padded + i * 8), registers[i]);
+        }
+        memcpy(array, padded, sizeof(i32) * arrayLength);
+    }
+};
+typedef SimdSortI32x8Network SimdSortI32Network;
+#elif defined(USE_SSE)
+typedef SimdSortingNetwork<SimdSortI32Traits> SimdSortI32Network;
+#endif
 
-    //Merge the subarrays
-    for (i64 size = SUBARRAY_SIZE; size < arrayLength; size *= 2)
+//Sorts the small ranges left over by IntroSort and the short runs built by TimSort. Returns false if the range
+//still needs to be insertion sorted, which is the case unless a sorting network exists for T with its default ordering.
+//Only i32 has one, as equal i32s are indistinguishable. Floats only use it through BitonicSort, which sorts them in total order
+//rather than by operator<, so it would reorder -0.0 and 0.0 where TimSort must keep them stable
+template<typename T, typename Less>
+struct SmallRangeSorter
+{
+    static inline bool Sort(T *, T *)
+    {
+        return false;
+    }
+};
+#ifdef USE_SSE
+template<>
+struct SmallRangeSorter<i32, OperatorLess<i32>>
+{
+    static inline bool Sort(i32 *begin, i32 *end)
     {
-        for (i64 left = 0; left < arrayLength; left += 2 * size)
+        if (end - begin > 32)
         {
-            i64 mid = left + size - 1;
-            i64 right = AC_MIN(left + (2 * size) - 1, arrayLength - 1);
+            return false;
+        }
+        SimdSortI32Network::Sort(begin, end - begin);
+        return true;
+    }
+};
+#endif
+
+//Below this size, partitions are finished with insertion sort
+#define INTROSORT_INSERTION_THRESHOLD 24
+//Above this size, the pivot is chosen with Tukey's ninther instead of median of 3
+#define INTROSORT_NINTHER_THRESHOLD 128
+//Maximum number of moves a partial insertion sort may do before it gives up on an almost sorted partition
+#define INTROSORT_PARTIAL_INSERTION_LIMIT 8
+//Number of elements whose comparison results are buffered at a time by the branchless partition
+#define INTROSORT_BLOCK_SIZE 64
 
-            //Sanity check for if the left subarray is the final subarray
-            //'mid' ends up being greater than 'count' if this were the case, which causes problems in
-            //  Merge() which sets the length of the right subarray to 'right - mid'
-            if (mid >= arrayLength)
-                continue;
+template<typename T>
+inline void SortSwap(T *A, T *B)
+{
+    T temp = *A;
+    *A = *B;
+    *B = temp;
+}
 
-            MergeSort<T>(array, left, mid, right, comparator);
+template<typename T, typename Less>
+inline void InsertionSortRange(T *begin, T *end, Less &less)
+{
+    if (begin == end)
+    {
+        return;
+    }
+    for (T *current = begin + 1; current != end; current++)
+    {
+        T *sift = current;
+        T *siftPrev = current - 1;
+        if (less(*sift, *siftPrev))
+        {
+            T temp = *sift;
+            do
+            {
+                *sift-- = *siftPrev;
+            } while (sift != begin && less(temp, *--siftPrev));
+            *sift = temp;
+        }
+    }
+}
+//Requires an element before begin that is not greater than any element in the range, which acts as a sentinel
+template<typename T, typename Less>
+inline void UnguardedInsertionSortRange(T *begin, T *end, Less &less)
+{
+    if (begin == end)
+    {
+        return;
+    }
+    for (T *current = begin + 1; current != end; current++)
+    {
+        T *sift = current;
+        T *siftPrev = current - 1;
+        if (less(*sift, *siftPrev))
+        {
+            T temp = *sift;
+            do
+            {
+                *sift-- = *siftPrev;
+            } while (less(temp, *--siftPrev));
+            *sift = temp;
+        }
+    }
+}
+//Insertion sort that gives up and returns false once it has moved more than INTROSORT_PARTIAL_INSERTION_LIMIT elements.
+//Used to cheaply finish partitions that appear to already be sorted.
+template<typename T, typename Less>
+inline bool PartialInsertionSortRange(T *begin, T *end, Less &less)
+{
+    if (begin == end)
+    {
+        return true;
+    }
+    usize moves = 0;
+    for (T *current = begin + 1; current != end; current++)
+    {
+        T *sift = current;
+        T *siftPrev = current - 1;
+        if (less(*sift, *siftPrev))
+        {
+            T temp = *sift;
+            do
+            {
+                *sift-- = *siftPrev;
+            } while (sift != begin && less(temp, *--siftPrev));
+            *sift = temp;
+            moves += current - sift;
+        }
+        if (moves > INTROSORT_PARTIAL_INSERTION_LIMIT)
+        {
+            return false;
         }
     }
+    return true;
 }
 
-#define IMPL_COMPARATORS(nameOfType, compareVar) inline bool operator<(nameOfType &other) { return this->compareVar < other.compareVar;} inline bool operator>(nameOfType &other) { return this->compareVar > other.compareVar;} inline bool operator<=(nameOfType &other) { return this->compareVar <= other.compareVar;} inline bool operator>=(nameOfType &other) { return this->compareVar >= other.compareVar;} inline bool operator==(nameOfType &other) { return this->compareVar == other.compareVar;} inline bool operator!=(nameOfType &other) { return this->compareVar != other.compareVar;}
+template<typename T, typename Less>
+inline void HeapSiftDown(T *heap, usize index, usize heapLength, Less &less)
+{
+    T moving = heap[index];
+    while (true)
+    {
+        usize child = index * 2 + 1;
+        if (child >= heapLength)
+        {
+            break;
+        }
+        if (child + 1 < heapLength && less(heap[child], heap[child + 1]))
+        {
+            child++;
+        }
+        if (!less(moving, heap[child]))
+        {
+            break;
+        }
+        heap[index] = heap[child];
+        index = child;
+    }
+    heap[index] = moving;
+}
+template<typename T, typename Less>
+void HeapSortRange(T *begin, T *end, Less &less)
+{
+    usize length = end - begin;
+    if (length < 2)
+    {
+        return;
+    }
+    for (usize i = length / 2; i > 0; i--)
+    {
+        HeapSiftDown(begin, i - 1, length, less);
+    }
+    for (usize i = length - 1; i > 0; i--)
+    {
+        SortSwap(begin, begin + i);
+        HeapSiftDown(begin, 0, i, less);
+    }
+}
+
+template<typename T, typename Less>
+inline void SortTwo(T *A, T *B, Less &less)
+{
+    if (less(*B, *A))
+    {
+        SortSwap(A, B);
+    }
+}
+template<typename T, typename Less>
+inline void SortThree(T *A, T *B, T *C, Less &less)
+{
+    SortTwo(A, B, less);
+    SortTwo(B, C, less);
+    SortTwo(A, B, less);
+}
 
+//Swaps the elements at the buffered offsets from both sides of a block partition.
+//When the counts differ, a cyclic permutation is done instead of swaps, which needs fewer moves.
 template<typename T>
-i8 OperatorBasedComparator(T& A, T& B)
+inline void SwapOffsets(T *first, T *last, u8 *offsetsLeft, u8 *offsetsRight, usize num, bool useSwaps)
 {
-    if (A < B)
+    if (useSwaps)
     {
-        return -1;
+        for (usize i = 0; i < num; i++)
+        {
+            SortSwap(first + offsetsLeft[i], last - offsetsRight[i]);
+        }
     }
-    if (A > B)
+    else if (num > 0)
     {
-        return 1;
+        T *left = first + offsetsLeft[0];
+        T *right = last - offsetsRight[0];
+        T temp = *left;
+        *left = *right;
+        for (usize i = 1; i < num; i++)
+        {
+            left = first + offsetsLeft[i];
+            *right = *left;
+            right = last - offsetsRight[i];
+            *left = *right;
+        }
+        *right = temp;
     }
-    return 0;
+}
+
+//Partitions [begin, end) around *begin, putting elements equal to the pivot on the right.
+//Comparison results are first written into small offset buffers without branching (BlockQuicksort),
+//so the cost of mispredicted branches on random data disappears. Returns the final position of the pivot,
+//and whether the range was already partitioned.
+template<typename T, typename Less>
+T *PartitionRightBranchless(T *begin, T *end, Less &less, bool *alreadyPartitioned)
+{
+    T pivot = *begin;
+    T *first = begin;
+    T *last = end;
+
+    //find the first element greater than or equal to the pivot, the median of 3 guarantees that one exists
+    while (less(*++first, pivot));
+
+    //find the first element strictly less than the pivot from the right. if there was no element before first, guard the search
+    if (first - 1 == begin)
+    {
+        while (first < last && !less(*--last, pivot));
+    }
+    else
+    {
+        while (!less(*--last, pivot));
+    }
+
+    *alreadyPartitioned = first >= last;
+    if (!*alreadyPartitioned)
+    {
+        SortSwap(first, last);
+        first++;
+
+        u8 offsetsLeft[INTROSORT_BLOCK_SIZE];
+        u8 offsetsRight[INTROSORT_BLOCK_SIZE];
+
+        T *offsetsLeftBase = first;
+        T *offsetsRightBase = last;
+        usize numLeft = 0;
+        usize numRight = 0;
+        usize startLeft = 0;
+        usize startRight = 0;
+
+        while (first < last)
+        {
+            //fill up offset blocks with elements that are on the wrong side. when both blocks have to be refilled,
+            //the remaining unknown elements are split between them
+            usize numUnknown = last - first;
+            usize leftSplit = numLeft == 0 ? (numRight == 0 ? numUnknown / 2 : numUnknown) : 0;
+            usize rightSplit = numRight == 0 ? (numUnknown - leftSplit) : 0;
+
+            if (leftSplit >= INTROSORT_BLOCK_SIZE)
+            {
+                for (usize i = 0; i < INTROSORT_BLOCK_SIZE;)
+                {
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                }
+            }
+            else
+            {
+                for (usize i = 0; i < leftSplit;)
+                {
+                    offsetsLeft[numLeft] = (u8)i++; numLeft += !less(*first, pivot); first++;
+                }
+            }
+
+            if (rightSplit >= INTROSORT_BLOCK_SIZE)
+            {
+                for (usize i = 0; i < INTROSORT_BLOCK_SIZE;)
+                {
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                }
+            }
+            else
+            {
+                for (usize i = 0; i < rightSplit;)
+                {
+                    offsetsRight[numRight] = (u8)++i; numRight += less(*--last, pivot);
+                }
+            }
+
+            usize num = numLeft < numRight ? numLeft : numRight;
+            SwapOffsets(offsetsLeftBase, offsetsRightBase, offsetsLeft + startLeft, offsetsRight + startRight, num, numLeft == numRight);
+            numLeft -= num;
+            numRight -= num;
+            startLeft += num;
+            startRight += num;
+            if (numLeft == 0)
+            {
+                startLeft = 0;
+                offsetsLeftBase = first;
+            }
+            if (numRight == 0)
+            {
+                startRight = 0;
+                offsetsRightBase = last;
+            }
+        }
+
+        //one of the blocks may still hold misplaced elements, move them to the middle
+        if (numLeft > 0)
+        {
+            u8 *offsets = offsetsLeft + startLeft;
+            while (numLeft > 0)
+            {
+                numLeft--;
+                SortSwap(offsetsLeftBase + offsets[numLeft], --last);
+            }
+            first = last;
+        }
+        if (numRight > 0)
+        {
+            u8 *offsets = offsetsRight + startRight;
+            while (numRight > 0)
+            {
+                numRight--;
+                SortSwap(offsetsRightBase - offsets[numRight], first);
+                first++;
+            }
+            last = first;
+        }
+    }
+
+    T *pivotPosition = first - 1;
+    *begin = *pivotPosition;
+    *pivotPosition = pivot;
+    return pivotPosition;
+}
+
+//Partitions [begin, end) around *begin, putting elements equal to the pivot on the left.
+//Only used when the pivot equals the element before the range, in which case every element equal to it is already in place
+template<typename T, typename Less>
+T *PartitionLeft(T *begin, T *end, Less &less)
+{
+    T pivot = *begin;
+    T *first = begin;
+    T *last = end;
+
+    while (less(pivot, *--last));
+
+    if (last + 1 == end)
+    {
+        while (first < last && !less(pivot, *++first));
+    }
+    else
+    {
+        while (!less(pivot, *++first));
+    }
+
+    while (first < last)
+    {
+        SortSwap(first, last);
+        while (less(pivot, *--last));
+        while (!less(pivot, *++first));
+    }
+
+    T *pivotPosition = last;
+    *begin = *pivotPosition;
+    *pivotPosition = pivot;
+    return pivotPosition;
+}
+
+template<typename T, typename Less>
+void IntroSortLoop(T *begin, T *end, Less &less, i32 badAllowed, bool leftmost)
+{
+    while (true)
+    {
+        usize size = end - begin;
+        if (size < INTROSORT_INSERTION_THRESHOLD)
+        {
+            if (SmallRangeSorter<T, Less>::Sort(begin, end))
+            {
+                return;
+            }
+            if (leftmost)
+            {
+                InsertionSortRange(begin, end, less);
+            }
+            else UnguardedInsertionSortRange(begin, end, less);
+            return;
+        }
+
+        //choose the pivot as median of 3 or pseudomedian of 9, and move it to begin
+        usize halfSize = size / 2;
+        if (size > INTROSORT_NINTHER_THRESHOLD)
+        {
+            SortThree(begin, begin + halfSize, end - 1, less);
+            SortThree(begin + 1, begin + (halfSize - 1), end - 2, less);
+            SortThree(begin + 2, begin + (halfSize + 1), end - 3, less);
+            SortThree(begin + (halfSize - 1), begin + halfSize, begin + (halfSize + 1), less);
+            SortSwap(begin, begin + halfSize);
+        }
+        else SortThree(begin + halfSize, begin, end - 1, less);
+
+        //if the element before this partition is equal to the pivot, every element equal to the pivot
+        //can go to the left and never needs to be looked at again. this keeps many duplicates linear
+        if (!leftmost && !less(*(begin - 1), *begin))
+        {
+            begin = PartitionLeft(begin, end, less) + 1;
+            continue;
+        }
+
+        bool alreadyPartitioned;
+        T *pivotPosition = PartitionRightBranchless(begin, end, less, &alreadyPartitioned);
+
+        usize leftSize = pivotPosition - begin;
+        usize rightSize = end - (pivotPosition + 1);
+        bool highlyUnbalanced = leftSize < size / 8 || rightSize < size / 8;
+
+        if (highlyUnbalanced)
+        {
+            //too many bad partitions means the input is adversarial, fall back to a guaranteed n log n sort
+            badAllowed--;
+            if (badAllowed == 0)
+            {
+                HeapSortRange(begin, end, less);
+                return;
+            }
+
+            //otherwise break up patterns that may be causing the bad pivots
+            if (leftSize >= INTROSORT_INSERTION_THRESHOLD)
+            {
+                SortSwap(begin, begin + leftSize / 4);
+                SortSwap(pivotPosition - 1, pivotPosition - leftSize / 4);
+                if (leftSize > INTROSORT_NINTHER_THRESHOLD)
+                {
+                    SortSwap(begin + 1, begin + (leftSize / 4 + 1));
+                    SortSwap(begin + 2, begin + (leftSize / 4 + 2));
+                    SortSwap(pivotPosition - 2, pivotPosition - (leftSize / 4 + 1));
+                    SortSwap(pivotPosition - 3, pivotPosition - (leftSize / 4 + 2));
+                }
+            }
+            if (rightSize >= INTROSORT_INSERTION_THRESHOLD)
+            {
+                SortSwap(pivotPosition + 1, pivotPosition + (1 + rightSize / 4));
+                SortSwap(end - 1, end - rightSize / 4);
+                if (rightSize > INTROSORT_NINTHER_THRESHOLD)
+                {
+                    SortSwap(pivotPosition + 2, pivotPosition + (2 + rightSize / 4));
+                    SortSwap(pivotPosition + 3, pivotPosition + (3 + rightSize / 4));
+                    SortSwap(end - 2, end - (1 + rightSize / 4));
+                    SortSwap(end - 3, end - (2 + rightSize / 4));
+                }
+            }
+        }
+        else if (alreadyPartitioned && PartialInsertionSortRange(begin, pivotPosition, less) && PartialInsertionSortRange(pivotPosition + 1, end, less))
+        {
+            //the partition was balanced and needed no swaps, and both halves turned out to be (nearly) sorted
+            return;
+        }
+
+        //recurse into the left side and loop on the right
+        IntroSortLoop(begin, pivotPosition, less, badAllowed, leftmost);
+        begin = pivotPosition + 1;
+        leftmost = false;
+    }
+}
+
+//In place, unstable pattern-defeating quicksort (Orson Peters' pdqsort): quicksort with branchless block partitioning,
+//insertion sort for small partitions, linear time on sorted, reverse sorted and all-equal inputs,
+//and a heapsort fallback that guarantees O(n log n) on adversarial inputs.
+//less is a functor returning true if A should be ordered before B, and is inlined at every comparison.
+template<typename T, typename Less>
+void IntroSort(T* array, usize arrayLength, Less less)
+{
+    if (arrayLength < 2)
+    {
+        return;
+    }
+    i32 log2 = 0;
+    for (usize length = arrayLength; length > 1; length >>= 1)
+    {
+        log2++;
+    }
+    IntroSortLoop(array, array + arrayLength, less, log2, true);
+}
+template<typename T>
+void IntroSort(T* array, usize arrayLength, i8(*comparator)(T&, T&))
+{
+    IntroSort(array, arrayLength, FunctionComparatorLess<T>(comparator));
+}
+template<typename T>
+void IntroSort(T* array, usize arrayLength)
+{
+    IntroSort(array, arrayLength, OperatorLess<T>());
+}
+
+template<typename T, typename Less>
+void NthElementLoop(T *begin, T *nth, T *end, Less &less, i32 badAllowed, bool leftmost)
+{
+    while (true)
+    {
+        usize size = end - begin;
+        if (size < INTROSORT_INSERTION_THRESHOLD)
+        {
+            InsertionSortRange(begin, end, less);
+            return;
+        }
+
+        usize halfSize = size / 2;
+        if (size > INTROSORT_NINTHER_THRESHOLD)
+        {
+            SortThree(begin, begin + halfSize, end - 1, less);
+            SortThree(begin + 1, begin + (halfSize - 1), end - 2, less);
+            SortThree(begin + 2, begin + (halfSize + 1), end - 3, less);
+            SortThree(begin + (halfSize - 1), begin + halfSize, begin + (halfSize + 1), less);
+            SortSwap(begin, begin + halfSize);
+        }
+        else SortThree(begin + halfSize, begin, end - 1, less);
+
+        //as in IntroSortLoop, runs of elements equal to the one before the range are moved left in one pass
+        if (!leftmost && !less(*(begin - 1), *begin))
+        {
+            T *equalEnd = PartitionLeft(begin, end, less) + 1;
+            if (nth < equalEnd)
+            {
+                return;
+            }
+            begin = equalEnd;
+            continue;
+        }
+
+        bool alreadyPartitioned;
+        T *pivotPosition = PartitionRightBranchless(begin, end, less, &alreadyPartitioned);
+        if (pivotPosition == nth)
+        {
+            return;
+        }
+
+        usize leftSize = pivotPosition - begin;
+        usize rightSize = end - (pivotPosition + 1);
+        if (leftSize < size / 8 || rightSize < size / 8)
+        {
+            //adversarial input, sorting the remaining range bounds the worst case at n log n
+            badAllowed--;
+            if (badAllowed == 0)
+            {
+                HeapSortRange(begin, end, less);
+                return;
+            }
+        }
+
+        if (nth < pivotPosition)
+        {
+            end = pivotPosition;
+        }
+        else
+        {
+            begin = pivotPosition + 1;
+            leftmost = false;
+        }
+    }
+}
+
+//Reorders the array so that the element at nthIndex is the one that would be there if the array were sorted,
+//with every element before it ordered before or equal to it and every element after it not ordered before it.
+//Introselect: average O(n) quickselect using IntroSort's partitioning, with a heapsort fallback on adversarial input.
+template<typename T, typename Less>
+void NthElement(T* array, usize nthIndex, usize arrayLength, Less less)
+{
+    if (nthIndex >= arrayLength || arrayLength < 2)
+    {
+        return;
+    }
+    i32 log2 = 0;
+    for (usize length = arrayLength; length > 1; length >>= 1)
+    {
+        log2++;
+    }
+    NthElementLoop(array, array + nthIndex, array + arrayLength, less, log2, true);
+}
+template<typename T>
+void NthElement(T* array, usize nthIndex, usize arrayLength)
+{
+    NthElement(array, nthIndex, arrayLength, OperatorLess<T>());
+}
+
+//Sorts the first middleIndex elements of the array into the positions they would have if the whole array were sorted,
+//leaving the rest in an unspecified order. O(n + k log k) for k = middleIndex
+template<typename T, typename Less>
+void PartialSort(T* array, usize middleIndex, usize arrayLength, Less less)
+{
+    if (middleIndex >= arrayLength)
+    {
+        IntroSort(array, arrayLength, less);
+        return;
+    }
+    if (middleIndex == 0)
+    {
+        return;
+    }
+    NthElement(array, middleIndex - 1, arrayLength, less);
+    IntroSort(array, middleIndex - 1, less);
+}
+template<typename T>
+void PartialSort(T* array, usize middleIndex, usize arrayLength)
+{
+    PartialSort(array, middleIndex, arrayLength, OperatorLess<T>());
+}
+
+//Maps a float's bits to an i32 whose signed order is IEEE 754's total order: -NaN, -INF, ..., -0.0, 0.0, ..., INF, NaN.
+//Negative floats have every bit but the sign flipped to reverse their order, so mapping a key again gives back the float
+inline i32 FloatTotalOrderKey(i32 bits)
+{
+    return bits ^ (i32)(((u32)bits >> 31) * 0x7FFFFFFFu);
+}
+struct FloatTotalOrderLess
+{
+    inline bool operator()(float &A, float &B)
+    {
+        i32 a;
+        i32 b;
+        memcpy(&a, &A, sizeof(i32));
+        memcpy(&b, &B, sizeof(i32));
+        return FloatTotalOrderKey(a) < FloatTotalOrderKey(b);
+    }
+};
+
+//Sorts floats and i32s with a vectorised sorting network when there are at most 32 of them, and with IntroSort
+//otherwise (which uses the same network for small partitions of i32s). Unlike the generic BitonicSort, any length is accepted.
+//Floats are sorted in total order, so NaNs are kept (those with the sign bit set first, the rest last) and -0.0 comes before 0.0
+inline void BitonicSort(float* array, usize arrayLength)
+{
+#ifdef USE_SSE
+    if (arrayLength <= 32)
+    {
+        i32 keys[32];
+        memcpy(keys, array, sizeof(float) * arrayLength);
+        for (usize i = 0; i < arrayLength; i++)
+        {
+            keys[i] = FloatTotalOrderKey(keys[i]);
+        }
+        SimdSortI32Network::Sort(keys, arrayLength);
+        for (usize i = 0; i < arrayLength; i++)
+        {
+            keys[i] = FloatTotalOrderKey(keys[i]);
+        }
+        memcpy(array, keys, sizeof(float) * arrayLength);
+        return;
+    }
+#endif
+    IntroSort(array, arrayLength, FloatTotalOrderLess());
+}
+inline void BitonicSort(i32* array, usize arrayLength)
+{
+#ifdef USE_SSE
+    if (arrayLength <= 32)
+    {
+        SimdSortI32Network::Sort(array, arrayLength);
+        return;
+    }
+#endif
+    IntroSort(array, arrayLength, OperatorLess<i32>());
+}
+
+//TimSort merges runs that are at least this long, shorter arrays are binary insertion sorted
+#define TIMSORT_MIN_MERGE 32
+//Number of consecutive wins by one run before merging switches to galloping
+#define TIMSORT_MIN_GALLOP 7
+//Enough pending runs for any array length, since run lengths on the stack grow at least as fast as the fibonacci sequence
+#define TIMSORT_MAX_PENDING_RUNS 85
+
+template<typename T>
+inline void SortCopy(T *destination, T *source, usize count)
+{
+    for (usize i = 0; i < count; i++)
+    {
+        destination[i] = source[i];
+    }
+}
+template<typename T>
+inline void SortCopyBackward(T *destination, T *source, usize count)
+{
+    for (usize i = count; i > 0; i--)
+    {
+        destination[i - 1] = source[i - 1];
+    }
+}
+
+//State of a single TimSort call. Holds the stack of pending runs and the scratch buffer used by every merge.
+template<typename T, typename Less>
+struct TimSortState
+{
+    T *array;
+    Less *less;
+    IAllocator allocator;
+    T *scratch;
+    usize scratchCapacity;
+    usize minGallop;
+    usize runBase[TIMSORT_MAX_PENDING_RUNS];
+    usize runLength[TIMSORT_MAX_PENDING_RUNS];
+    usize stackSize;
+
+    TimSortState(T *array, Less *less, IAllocator allocator)
+    {
+        this->array = array;
+        this->less = less;
+        this->allocator = allocator;
+        scratch = NULL;
+        scratchCapacity = 0;
+        minGallop = TIMSORT_MIN_GALLOP;
+        stackSize = 0;
+    }
+    void deinit()
+    {
+        if (scratch != NULL)
+        {
+            allocator.FREEPTR(scratch);
+        }
+        scratchCapacity = 0;
+    }
+    //merges only ever copy the shorter run, so a buffer of half the array is allocated once, on the first merge, and reused by every later one
+    T *EnsureScratch(usize minCapacity, usize arrayLength)
+    {
+        if (scratchCapacity < minCapacity)
+        {
+            if (scratch != NULL)
+            {
+                allocator.Free(scratch);
+            }
+            scratchCapacity = AC_MAX(minCapacity, arrayLength / 2 + 1);
+            scratch = (T*)allocator.Allocate(sizeof(T) * scratchCapacity);
+        }
+        return scratch;
+    }
+
+    //Returns the number of elements before which key should be inserted into the sorted range [base, base + length),
+    //placing it before any equal elements. The search starts at hint and gallops outwards exponentially before binary searching,
+    //so it finds positions near the hint in O(log distance) comparisons.
+    usize GallopLeft(T &key, T *base, usize length, usize hint)
+    {
+        i64 lastOffset = 0;
+        i64 offset = 1;
+        i64 signedLength = (i64)length;
+        i64 signedHint = (i64)hint;
+        Less &lessThan = *less;
+        if (lessThan(base[hint], key))
+        {
+            //gallop right until base[hint + lastOffset] < key <= base[hint + offset]
+            i64 maxOffset = signedLength - signedHint;
+            while (offset < maxOffset && lessThan(base[signedHint + offset], key))
+            {
+                lastOffset = offset;
+                offset = (offset << 1) + 1;
+            }
+            if (offset > maxOffset)
+            {
+                offset = maxOffset;
+            }
+            lastOffset += signedHint;
+            offset += signedHint;
+        }
+        else
+        {
+            //gallop left until base[hint - offset] < key <= base[hint - lastOffset]
+            i64 maxOffset = signedHint + 1;
+            while (offset < maxOffset && !lessThan(base[signedHint - offset], key))
+            {
+                lastOffset = offset;
+                offset = (offset << 1) + 1;
+            }
+            if (offset > maxOffset)
+            {
+                offset = maxOffset;
+            }
+            i64 temp = lastOffset;
+            lastOffset = signedHint - offset;
+            offset = signedHint - temp;
+        }
+        //base[lastOffset] < key <= base[offset], binary search the gap
+        lastOffset++;
+        while (lastOffset < offset)
+        {
+            i64 mid = lastOffset + ((offset - lastOffset) >> 1);
+            if (lessThan(base[mid], key))
+            {
+                lastOffset = mid + 1;
+            }
+            else offset = mid;
+        }
+        return (usize)offset;
+    }
+    //Like GallopLeft, but places key after any equal elements
+    usize GallopRight(T &key, T *base, usize length, usize hint)
+    {
+        i64 lastOffset = 0;
+        i64 offset = 1;
+        i64 signedLength = (i64)length;
+        i64 signedHint = (i64)hint;
+        Less &lessThan = *less;
+        if (lessThan(key, base[hint]))
+        {
+            //gallop left until base[hint - offset] <= key < base[hint - lastOffset]
+            i64 maxOffset = signedHint + 1;
+            while (offset < maxOffset && lessThan(key, base[signedHint - offset]))
+            {
+                lastOffset = offset;
+                offset = (offset << 1) + 1;
+            }
+            if (offset > maxOffset)
+            {
+                offset = maxOffset;
+            }
+            i64 temp = lastOffset;
+            lastOffset = signedHint - offset;
+            offset = signedHint - temp;
+        }
+        else
+        {
+            //gallop right until base[hint + lastOffset] <= key < base[hint + offset]
+            i64 maxOffset = signedLength - signedHint;
+            while (offset < maxOffset && !lessThan(key, base[signedHint + offset]))
+            {
+                lastOffset = offset;
+                offset = (offset << 1) + 1;
+            }
+            if (offset > maxOffset)
+            {
+                offset = maxOffset;
+            }
+            lastOffset += signedHint;
+            offset += signedHint;
+        }
+        lastOffset++;
+        while (lastOffset < offset)
+        {
+            i64 mid = lastOffset + ((offset - lastOffset) >> 1);
+            if (lessThan(key, base[mid]))
+            {
+                offset = mid;
+            }
+            else lastOffset = mid + 1;
+        }
+        return (usize)offset;
+    }
+
+    //Merges two adjacent runs where the first is the shorter one. The first run is moved into scratch and merged from the front.
+    void MergeLow(usize base1, usize length1, usize base2, usize length2, usize arrayLength)
+    {
+        Less &lessThan = *less;
+        T *temp = EnsureScratch(length1, arrayLength);
+        SortCopy(temp, array + base1, length1);
+        usize cursor1 = 0;
+        usize cursor2 = base2;
+        usize destination = base1;
+
+        array[destination++] = array[cursor2++];
+        if (--length2 == 0)
+        {
+            SortCopy(array + destination, temp + cursor1, length1);
+            return;
+        }
+        if (length1 == 1)
+        {
+            SortCopy(array + destination, array + cursor2, length2);
+            array[destination + length2] = temp[cursor1];
+            return;
+        }
+
+        usize currentMinGallop = minGallop;
+        while (true)
+        {
+            usize count1 = 0;
+            usize count2 = 0;
+            bool done = false;
+
+            //merge one element at a time until one run keeps winning
+            do
+            {
+                if (lessThan(array[cursor2], temp[cursor1]))
+                {
+                    array[destination++] = array[cursor2++];
+                    count2++;
+                    count1 = 0;
+                    if (--length2 == 0)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+                else
+                {
+                    array[destination++] = temp[cursor1++];
+                    count1++;
+                    count2 = 0;
+                    if (--length1 == 1)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+            } while ((count1 | count2) < currentMinGallop);
+            if (done)
+            {
+                break;
+            }
+
+            //one run is winning consistently, gallop to copy whole stretches of it at once
+            do
+            {
+                count1 = GallopRight(array[cursor2], temp + cursor1, length1, 0);
+                if (count1 != 0)
+                {
+                    SortCopy(array + destination, temp + cursor1, count1);
+                    destination += count1;
+                    cursor1 += count1;
+                    length1 -= count1;
+                    if (length1 <= 1)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+                array[destination++] = array[cursor2++];
+                if (--length2 == 0)
+                {
+                    done = true;
+                    break;
+                }
+
+                count2 = GallopLeft(temp[cursor1], array + cursor2, length2, 0);
+                if (count2 != 0)
+                {
+                    SortCopy(array + destination, array + cursor2, count2);
+                    destination += count2;
+                    cursor2 += count2;
+                    length2 -= count2;
+                    if (length2 == 0)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+                array[destination++] = temp[cursor1++];
+                if (--length1 == 1)
+                {
+                    done = true;
+                    break;
+                }
+                if (currentMinGallop > 0)
+                {
+                    currentMinGallop--;
+                }
+            } while (count1 >= TIMSORT_MIN_GALLOP || count2 >= TIMSORT_MIN_GALLOP);
+            if (done)
+            {
+                break;
+            }
+            //penalize leaving galloping mode
+            currentMinGallop += 2;
+        }
+        minGallop = currentMinGallop < 1 ? 1 : currentMinGallop;
+
+        if (length1 == 1)
+        {
+            SortCopy(array + destination, array + cursor2, length2);
+            array[destination + length2] = temp[cursor1];
+        }
+        else
+        {
+            //length1 == 0 is only possible with a comparator that is not a strict weak ordering
+            assert(length1 != 0);
+            SortCopy(array + destination, temp + cursor1, length1);
+        }
+    }
+    //Merges two adjacent runs where the second is the shorter one. The second run is moved into scratch and merged from the back.
+    void MergeHigh(usize base1, usize length1, usize base2, usize length2, usize arrayLength)
+    {
+        Less &lessThan = *less;
+        T *temp = EnsureScratch(length2, arrayLength);
+        SortCopy(temp, array + base2, length2);
+        //cursors point one past the next element to take, so that they never go below 0
+        usize cursor1 = base1 + length1;
+        usize cursor2 = length2;
+        usize destination = base2 + length2;
+
+        array[--destination] = array[--cursor1];
+        if (--length1 == 0)
+        {
+            SortCopy(array + destination - length2, temp, length2);
+            return;
+        }
+        if (length2 == 1)
+        {
+            destination -= length1;
+            cursor1 -= length1;
+            SortCopyBackward(array + destination, array + cursor1, length1);
+            array[destination - 1] = temp[cursor2 - 1];
+            return;
+        }
+
+        usize currentMinGallop = minGallop;
+        while (true)
+        {
+            usize count1 = 0;
+            usize count2 = 0;
+            bool done = false;
+
+            do
+            {
+                if (lessThan(temp[cursor2 - 1], array[cursor1 - 1]))
+                {
+                    array[--destination] = array[--cursor1];
+                    count1++;
+                    count2 = 0;
+                    if (--length1 == 0)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+                else
+                {
+                    array[--destination] = temp[--cursor2];
+                    count2++;
+                    count1 = 0;
+                    if (--length2 == 1)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+            } while ((count1 | count2) < currentMinGallop);
+            if (done)
+            {
+                break;
+            }
+
+            do
+            {
+                count1 = length1 - GallopRight(temp[cursor2 - 1], array + base1, length1, length1 - 1);
+                if (count1 != 0)
+                {
+                    destination -= count1;
+                    cursor1 -= count1;
+                    length1 -= count1;
+                    SortCopyBackward(array + destination, array + cursor1, count1);
+                    if (length1 == 0)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+                array[--destination] = temp[--cursor2];
+                if (--length2 == 1)
+                {
+                    done = true;
+                    break;
+                }
+
+                count2 = length2 - GallopLeft(array[cursor1 - 1], temp, length2, length2 - 1);
+                if (count2 != 0)
+                {
+                    destination -= count2;
+                    cursor2 -= count2;
+                    length2 -= count2;
+                    SortCopy(array + destination, temp + cursor2, count2);
+                    if (length2 <= 1)
+                    {
+                        done = true;
+                        break;
+                    }
+                }
+                array[--destination] = array[--cursor1];
+                if (--length1 == 0)
+                {
+                    done = true;
+                    break;
+                }
+                if (currentMinGallop > 0)
+                {
+                    currentMinGallop--;
+                }
+            } while (count1 >= TIMSORT_MIN_GALLOP || count2 >= TIMSORT_MIN_GALLOP);
+            if (done)
+            {
+                break;
+            }
+            currentMinGallop += 2;
+        }
+        minGallop = currentMinGallop < 1 ? 1 : currentMinGallop;
+
+        if (length2 == 1)
+        {
+            destination -= length1;
+            cursor1 -= length1;
+            SortCopyBackward(array + destination, array + cursor1, length1);
+            array[destination - 1] = temp[cursor2 - 1];
+        }
+        else
+        {
+            assert(length2 != 0);
+            SortCopy(array + destination - length2, temp, length2);
+        }
+    }
+    //Merges the runs at stack index i and i + 1
+    void MergeAt(usize i, usize arrayLength)
+    {
+        usize base1 = runBase[i];
+        usize length1 = runLength[i];
+        usize base2 = runBase[i + 1];
+        usize length2 = runLength[i + 1];
+
+        runLength[i] = length1 + length2;
+        if (i == stackSize - 3)
+        {
+            runBase[i + 1] = runBase[i + 2];
+            runLength[i + 1] = runLength[i + 2];
+        }
+        stackSize--;
+
+        //elements of run 1 that are already smaller than all of run 2, and elements of run 2 already larger than all of run 1, stay in place
+        usize skip = GallopRight(array[base2], array + base1, length1, 0);
+        base1 += skip;
+        length1 -= skip;
+        if (length1 == 0)
+        {
+            return;
+        }
+        length2 = GallopLeft(array[base1 + length1 - 1], array + base2, length2, length2 - 1);
+        if (length2 == 0)
+        {
+            return;
+        }
+
+        if (length1 <= length2)
+        {
+            MergeLow(base1, length1, base2, length2, arrayLength);
+        }
+        else MergeHigh(base1, length1, base2, length2, arrayLength);
+    }
+    //Merges runs until the stack satisfies length[i - 2] > length[i - 1] + length[i] and length[i - 1] > length[i],
+    //which keeps merges balanced and bounds the stack size
+    void MergeCollapse(usize arrayLength)
+    {
+        while (stackSize > 1)
+        {
+            usize n = stackSize - 2;
+            if ((n > 0 && runLength[n - 1] <= runLength[n] + runLength[n + 1]) || (n > 1 && runLength[n - 2] <= runLength[n] + runLength[n - 1]))
+            {
+                if (runLength[n - 1] < runLength[n + 1])
+                {
+                    n--;
+                }
+            }
+            else if (runLength[n] > runLength[n + 1])
+            {
+                break;
+            }
+            MergeAt(n, arrayLength);
+        }
+    }
+    void MergeForceCollapse(usize arrayLength)
+    {
+        while (stackSize > 1)
+        {
+            usize n = stackSize - 2;
+            if (n > 0 && runLength[n - 1] < runLength[n + 1])
+            {
+                n--;
+            }
+            MergeAt(n, arrayLength);
+        }
+    }
+};
+
+//Returns the length of the run starting at begin, reversing it in place if it is strictly descending
+template<typename T, typename Less>
+usize CountRunAndMakeAscending(T *begin, T *end, Less &less)
+{
+    T *runEnd = begin + 1;
+    if (runEnd == end)
+    {
+        return 1;
+    }
+    if (less(*runEnd, *begin))
+    {
+        runEnd++;
+        while (runEnd < end && less(*runEnd, *(runEnd - 1)))
+        {
+            runEnd++;
+        }
+        //strictly descending, so reversing it keeps the sort stable
+        T *low = begin;
+        T *high = runEnd - 1;
+        while (low < high)
+        {
+            SortSwap(low++, high--);
+        }
+    }
+    else
+    {
+        runEnd++;
+        while (runEnd < end && !less(*runEnd, *(runEnd - 1)))
+        {
+            runEnd++;
+        }
+    }
+    return runEnd - begin;
+}
+//Stable insertion sort of [begin, end) where [begin, sortedEnd) is already sorted, using binary search to find each insertion point
+template<typename T, typename Less>
+void BinaryInsertionSortRange(T *begin, T *end, T *sortedEnd, Less &less)
+{
+    if (sortedEnd == begin)
+    {
+        sortedEnd++;
+    }
+    for (; sortedEnd < end; sortedEnd++)
+    {
+        T pivot = *sortedEnd;
+        T *left = begin;
+        T *right = sortedEnd;
+        while (left < right)
+        {
+            T *mid = left + (right - left) / 2;
+            if (less(pivot, *mid))
+            {
+                right = mid;
+            }
+            else left = mid + 1;
+        }
+        SortCopyBackward(left + 1, left, sortedEnd - left);
+        *left = pivot;
+    }
+}
+//Picks a run length between TIMSORT_MIN_MERGE / 2 and TIMSORT_MIN_MERGE such that arrayLength / minRun is,
+//or is slightly less than, a power of two, which keeps the final merges balanced
+inline usize TimSortMinRun(usize arrayLength)
+{
+    usize remainder = 0;
+    while (arrayLength >= TIMSORT_MIN_MERGE)
+    {
+        remainder |= arrayLength & 1;
+        arrayLength >>= 1;
+    }
+    return arrayLength + remainder;
+}
+
+//Stable, adaptive merge sort (Tim Peters' TimSort). Finds natural ascending/descending runs in the input, extends short ones to
+//a computed minimum run length with binary insertion sort, and merges them with galloping so that partially ordered input
+//sorts in close to linear time. All merges go through one scratch buffer from scratchAllocator of at most half the array length.
+template<typename T, typename Less>
+void TimSort(T* array, usize arrayLength, IAllocator scratchAllocator, Less less)
+{
+    if (arrayLength < 2)
+    {
+        return;
+    }
+    T *begin = array;
+    T *end = array + arrayLength;
+    if (arrayLength < TIMSORT_MIN_MERGE)
+    {
+        //equal i32s are indistinguishable, so the unstable network is fine for them
+        if (SmallRangeSorter<T, Less>::Sort(begin, end))
+        {
+            return;
+        }
+        usize initialRunLength = CountRunAndMakeAscending(begin, end, less);
+        BinaryInsertionSortRange(begin, end, begin + initialRunLength, less);
+        return;
+    }
+
+    TimSortState<T, Less> state = TimSortState<T, Less>(array, &less, scratchAllocator);
+    usize minRun = TimSortMinRun(arrayLength);
+    usize low = 0;
+    usize remaining = arrayLength;
+    while (remaining > 0)
+    {
+        usize runLength = CountRunAndMakeAscending(begin + low, end, less);
+        if (runLength < minRun)
+        {
+            usize forcedLength = remaining < minRun ? remaining : minRun;
+            if (!SmallRangeSorter<T, Less>::Sort(begin + low, begin + low + forcedLength))
+            {
+                BinaryInsertionSortRange(begin + low, begin + low + forcedLength, begin + low + runLength, less);
+            }
+            runLength = forcedLength;
+        }
+        state.runBase[state.stackSize] = low;
+        state.runLength[state.stackSize] = runLength;
+        state.stackSize++;
+        state.MergeCollapse(arrayLength);
+
+        low += runLength;
+        remaining -= runLength;
+    }
+    state.MergeForceCollapse(arrayLength);
+    state.deinit();
+}
+template<typename T, typename Less>
+void TimSort(T* array, usize arrayLength, Less less)
+{
+    TimSort(array, arrayLength, GetCAllocator(), less);
+}
+template<typename T>
+void TimSort(T* array, usize arrayLength, i8(*comparator)(T&, T&))
+{
+    TimSort(array, arrayLength, GetCAllocator(), FunctionComparatorLess<T>(comparator));
+}
+template<typename T>
+void TimSort(T* array, usize arrayLength, IAllocator scratchAllocator, i8(*comparator)(T&, T&))
+{
+    TimSort(array, arrayLength, scratchAllocator, FunctionComparatorLess<T>(comparator));
+}
+
+//Bits sorted per radix pass. 11 bits sorts 32 bit keys in 3 passes and 64 bit keys in 6, with 2048 entry histograms that still fit in L1
+#define RADIX_DIGIT_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_DIGIT_BITS)
+//How many elements ahead of the scatter loop the destination of an element is prefetched
+#define RADIX_PREFETCH_DISTANCE 16
+//Below this length, radix sorts fall back to a stable insertion sort
+#define RADIX_SMALL_SORT_THRESHOLD 64
+
+#ifdef _MSC_VER
+#define SORT_PREFETCH_WRITE(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+#define SORT_PREFETCH_WRITE(address) __builtin_prefetch((address), 1)
+#endif
+
+//Maps keys to unsigned integers whose unsigned order matches the order of the original values
+inline u32 RadixSortableKey(u32 value)
+{
+    return value;
+}
+inline u64 RadixSortableKey(u64 value)
+{
+    return value;
+}
+inline u32 RadixSortableKey(i32 value)
+{
+    return (u32)value ^ 0x80000000u;
+}
+inline u64 RadixSortableKey(i64 value)
+{
+    return (u64)value ^ 0x8000000000000000ull;
+}
+//Positive floats only need their sign bit set, negative floats have every bit flipped to reverse their order.
+//-0.0 is ordered before 0.0, and NaNs are ordered at either end depending on their sign bit
+inline u32 RadixSortableKey(float value)
+{
+    u32 bits;
+    memcpy(&bits, &value, sizeof(u32));
+    u32 mask = (u32)(-(i32)(bits >> 31)) | 0x80000000u;
+    return bits ^ mask;
+}
+inline u64 RadixSortableKey(double value)
+{
+    u64 bits;
+    memcpy(&bits, &value, sizeof(u64));
+    u64 mask = (u64)(-(i64)(bits >> 63)) | 0x8000000000000000ull;
+    return bits ^ mask;
+}
+
+template<typename T>
+struct RadixIdentityKey
+{
+    inline auto operator()(T &value) -> decltype(RadixSortableKey(value))
+    {
+        return RadixSortableKey(value);
+    }
+};
+template<typename T, typename KeyOf>
+struct RadixKeyLess
+{
+    KeyOf *keyOf;
+
+    inline bool operator()(T &A, T &B)
+    {
+        return (*keyOf)(A) < (*keyOf)(B);
+    }
+};
+
+//Stable LSD radix sort of array using scratch (of at least arrayLength elements) as the second buffer.
+//keyOf is a functor that returns an unsigned u32 or u64 key for an element, see RadixSortableKey.
+//All digit histograms are built in one read pass, and passes where every key shares the same digit are skipped,
+//so keys that only use their low bits (such as small IDs) only pay for the passes they need.
+//The histograms (up to 96KB for 64 bit keys) are allocated from scratchAllocator rather than the stack
+template<typename T, typename KeyOf>
+void RadixSortByKey(T* array, T* scratch, usize arrayLength, IAllocator scratchAllocator, KeyOf keyOf)
+{
+    typedef decltype(keyOf(*array)) KeyType;
+    const usize passesCount = (sizeof(KeyType) * 8 + RADIX_DIGIT_BITS - 1) / RADIX_DIGIT_BITS;
+
+    if (arrayLength < RADIX_SMALL_SORT_THRESHOLD)
+    {
+        RadixKeyLess<T, KeyOf> less;
+        less.keyOf = &keyOf;
+        BinaryInsertionSortRange(array, array + arrayLength, array, less);
+        return;
+    }
+
+    usize *histograms = (usize*)scratchAllocator.Allocate(sizeof(usize) * passesCount * RADIX_BUCKETS);
+    memset(histograms, 0, sizeof(usize) * passesCount * RADIX_BUCKETS);
+    for (usize i = 0; i < arrayLength; i++)
+    {
+        KeyType key = keyOf(array[i]);
+        for (usize pass = 0; pass < passesCount; pass++)
+        {
+            histograms[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_DIGIT_BITS)) & (RADIX_BUCKETS - 1))]++;
+        }
+    }
+
+    T *source = array;
+    T *destination = scratch;
+    for (usize pass = 0; pass < passesCount; pass++)
+    {
+        usize shift = pass * RADIX_DIGIT_BITS;
+        usize *histogram = histograms + pass * RADIX_BUCKETS;
+        if (histogram[(keyOf(source[0]) >> shift) & (RADIX_BUCKETS - 1)] == arrayLength)
+        {
+            continue;
+        }
+
+        //turn counts into starting offsets
+        usize offset = 0;
+        for (usize digit = 0; digit < RADIX_BUCKETS; digit++)
+        {
+            usize digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        //scatter is bound by random writes into up to 2048 streams, so warm up the line an upcoming element is written to
+        usize prefetchEnd = arrayLength > RADIX_PREFETCH_DISTANCE ? arrayLength - RADIX_PREFETCH_DISTANCE : 0;
+        usize i = 0;
+        for (; i < prefetchEnd; i++)
+        {
+            SORT_PREFETCH_WRITE(destination + histogram[(keyOf(source[i + RADIX_PREFETCH_DISTANCE]) >> shift) & (RADIX_BUCKETS - 1)]);
+            usize digit = (keyOf(source[i]) >> shift) & (RADIX_BUCKETS - 1);
+            destination[histogram[digit]++] = source[i];
+        }
+        for (; i < arrayLength; i++)
+        {
+            usize digit = (keyOf(source[i]) >> shift) & (RADIX_BUCKETS - 1);
+            destination[histogram[digit]++] = source[i];
+        }
+
+        T *temp = source;
+        source = destination;
+        destination = temp;
+    }
+    scratchAllocator.Free(histograms);
+    if (source != array)
+    {
+        SortCopy(array, source, arrayLength);
+    }
+}
+template<typename T, typename KeyOf>
+void RadixSortByKey(T* array, usize arrayLength, IAllocator scratchAllocator, KeyOf keyOf)
+{
+    if (arrayLength < RADIX_SMALL_SORT_THRESHOLD)
+    {
+        RadixSortByKey(array, (T*)NULL, arrayLength, scratchAllocator, keyOf);
+        return;
+    }
+    T *scratch = (T*)scratchAllocator.Allocate(sizeof(T) * arrayLength);
+    RadixSortByKey(array, scratch, arrayLength, scratchAllocator, keyOf);
+    scratchAllocator.Free(scratch);
+}
+//Sorts u32, u64, i32, i64, float or double arrays in ascending order in linear time
+template<typename T>
+void RadixSort(T* array, usize arrayLength, IAllocator scratchAllocator)
+{
+    RadixSortByKey(array, arrayLength, scratchAllocator, RadixIdentityKey<T>());
+}
+template<typename T>
+void RadixSort(T* array, usize arrayLength)
+{
+    RadixSortByKey(array, arrayLength, GetCAllocator(), RadixIdentityKey<T>());
 }
\ No newline at end of file
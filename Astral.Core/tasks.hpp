@@ -0,0 +1,433 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "vector.hpp"
+#include "jobsystem.hpp"
+
+//Stackless C++20 coroutine tasks that run on the job system. A function returning Task<T> is a coroutine that
+//does nothing until it is awaited or run, so the caller decides where it starts. Inside a task:
+//  co_await Schedule(system)        continues the task as a job on any worker
+//  co_await otherTask               runs otherTask to completion and returns its result, without blocking a thread.
+//                                   A temporary task (co_await Child()) is freed once awaited, a named one must still be deinit'd
+//  co_await WhenAll(system, tasks)  runs the tasks as parallel jobs and continues once all have finished
+//  co_await event                   suspends until TaskEvent::Set is called from anywhere, such as an I/O completion
+//Suspended tasks hold no thread, so waiting on I/O costs nothing while the workers run other jobs and tasks.
+//Frames are allocated from the first IAllocator parameter of the coroutine, or the C allocator if it has none.
+//Needs compiler support for coroutines (C++20); without it this header declares nothing.
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <stdlib.h>
+
+#define TASK_FRAME_HEADER ((sizeof(IAllocator) + 15) & ~(usize)15)
+
+//GCC pairs calls to operator new and delete by name, and an instance of the operator new template that finds a frame's allocator
+//never pairs with the plain operator delete that frames are freed with, so it would warn at every coroutine definition.
+//Always inlining the allocation leaves no call to operator new for it to pair up, at any optimisation level
+#if defined(__GNUC__) && !defined(__clang__)
+#define TASK_FRAME_ALLOCATE_INLINE __attribute__((always_inline)) inline
+#else
+#define TASK_FRAME_ALLOCATE_INLINE inline
+#endif
+
+namespace threading
+{
+    inline IAllocator TaskFindAllocator()
+    {
+        return GetCAllocator();
+    }
+    template<typename... Rest>
+    inline IAllocator TaskFindAllocator(IAllocator &allocator, Rest &...)
+    {
+        return allocator;
+    }
+    template<typename First, typename... Rest>
+    inline IAllocator TaskFindAllocator(First &, Rest &...rest)
+    {
+        return TaskFindAllocator(rest...);
+    }
+
+    inline void TaskResumeJob(void *data)
+    {
+        std::coroutine_handle<>::from_address(data).resume();
+    }
+
+    //shared by the tasks started by one WhenAll, the last to finish resumes the awaiting task
+    struct TaskWhenAllState
+    {
+        volatile i64 remaining;
+        std::coroutine_handle<> parent;
+    };
+
+    struct TaskPromiseBase
+    {
+        //resumed when this task finishes, if it was awaited directly
+        std::coroutine_handle<> continuation;
+        TaskWhenAllState *whenAll;
+        //decremented when this task finishes, if it was started by RunTask
+        JobCounter *completion;
+        //used to run this task as a job
+        Job job;
+
+        TaskPromiseBase()
+        {
+            continuation = std::coroutine_handle<>();
+            whenAll = NULL;
+            completion = NULL;
+            job = Job();
+        }
+
+        //the frame's allocator is stored in front of it, so that it can be freed without knowing which it came from
+        template<typename... Args>
+        TASK_FRAME_ALLOCATE_INLINE static void *operator new(usize size, Args &...args)
+        {
+            IAllocator allocator = TaskFindAllocator(args...);
+            u8 *memory = (u8*)allocator.Allocate(size + TASK_FRAME_HEADER);
+            *(IAllocator*)memory = allocator;
+            return memory + TASK_FRAME_HEADER;
+        }
+        static void operator delete(void *frame)
+        {
+            u8 *memory = (u8*)frame - TASK_FRAME_HEADER;
+            IAllocator allocator = *(IAllocator*)memory;
+            allocator.Free(memory);
+        }
+
+        struct FinalAwaiter
+        {
+            inline bool await_ready() noexcept
+            {
+                return false;
+            }
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+            {
+                //once finishing is signalled the task may be destroyed by another thread, so nothing is read from it afterwards
+                TaskPromiseBase &promise = handle.promise();
+                if (promise.whenAll != NULL)
+                {
+                    TaskWhenAllState *whenAll = promise.whenAll;
+                    if (AtomicFetchAdd64(&whenAll->remaining, -1, MemoryOrder_AcqRel) == 1)
+                    {
+                        return whenAll->parent;
+                    }
+                    return std::noop_coroutine();
+                }
+                if (promise.completion != NULL)
+                {
+                    AtomicFetchAdd64(&promise.completion->pending, -1, MemoryOrder_Release);
+                    return std::noop_coroutine();
+                }
+                if (promise.continuation)
+                {
+                    return promise.continuation;
+                }
+                return std::noop_coroutine();
+            }
+            inline void await_resume() noexcept
+            {
+            }
+        };
+
+        inline std::suspend_always initial_suspend() noexcept
+        {
+            return std::suspend_always();
+        }
+        inline FinalAwaiter final_suspend() noexcept
+        {
+            return FinalAwaiter();
+        }
+        //the library does not use exceptions, so one escaping a task is fatal
+        inline void unhandled_exception()
+        {
+            abort();
+        }
+    };
+
+    template<typename T>
+    struct Task;
+
+    template<typename T>
+    struct TaskPromise : TaskPromiseBase
+    {
+        T value;
+
+        Task<T> get_return_object();
+        inline void return_value(T result)
+        {
+            value = result;
+        }
+        inline T Result()
+        {
+            return value;
+        }
+    };
+    template<>
+    struct TaskPromise<void> : TaskPromiseBase
+    {
+        Task<void> get_return_object();
+        inline void return_void()
+        {
+        }
+        inline void Result()
+        {
+        }
+    };
+
+    //awaits a task without taking ownership of its frame
+    template<typename T>
+    struct TaskAwaiter
+    {
+        std::coroutine_handle<TaskPromise<T>> handle;
+
+        inline bool await_ready()
+        {
+            return false;
+        }
+        inline std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+        inline T await_resume()
+        {
+            return handle.promise().Result();
+        }
+    };
+    //awaits a temporary task, freeing its frame once the result has been taken
+    template<typename T>
+    struct TaskOwningAwaiter : TaskAwaiter<T>
+    {
+        inline T await_resume()
+        {
+            T result = this->handle.promise().Result();
+            this->handle.destroy();
+            return result;
+        }
+    };
+    template<>
+    struct TaskOwningAwaiter<void> : TaskAwaiter<void>
+    {
+        inline void await_resume()
+        {
+            this->handle.destroy();
+        }
+    };
+
+    //A handle to a coroutine frame, which is freed with deinit once the task is done or was never started.
+    //Awaiting a task starts it and resumes the awaiter on whichever thread the task finishes on. Each task may be awaited or run only once.
+    //Awaiting a temporary task frees its frame once the result is taken, as nothing else could
+    template<typename T = void>
+    struct Task
+    {
+        typedef TaskPromise<T> promise_type;
+        std::coroutine_handle<promise_type> handle;
+
+        Task()
+        {
+            handle = std::coroutine_handle<promise_type>();
+        }
+        Task(std::coroutine_handle<promise_type> handle)
+        {
+            this->handle = handle;
+        }
+        //Destroys the coroutine frame. Tasks are plain handles like the other containers, so copies share the frame
+        void deinit()
+        {
+            if (handle)
+            {
+                handle.destroy();
+                handle = std::coroutine_handle<promise_type>();
+            }
+        }
+
+        inline bool IsDone()
+        {
+            return handle.done();
+        }
+        //The returned value, once the task is done
+        inline T Result()
+        {
+            return handle.promise().Result();
+        }
+
+        inline TaskAwaiter<T> operator co_await() &
+        {
+            TaskAwaiter<T> result;
+            result.handle = handle;
+            return result;
+        }
+        //nothing else can reach a temporary task's frame, so it is freed by the awaiter
+        inline TaskOwningAwaiter<T> operator co_await() &&
+        {
+            TaskOwningAwaiter<T> result;
+            result.handle = handle;
+            handle = std::coroutine_handle<promise_type>();
+            return result;
+        }
+    };
+
+    template<typename T>
+    Task<T> TaskPromise<T>::get_return_object()
+    {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+    inline Task<void> TaskPromise<void>::get_return_object()
+    {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+
+    struct TaskScheduleAwaiter
+    {
+        JobSystem *system;
+        Job job;
+
+        inline bool await_ready()
+        {
+            return false;
+        }
+        inline void await_suspend(std::coroutine_handle<> handle)
+        {
+            //the task may be resumed and this awaiter gone before RunJob returns, so it must be the last use of this
+            job = Job(&TaskResumeJob, handle.address());
+            RunJob(system, &job, NULL);
+        }
+        inline void await_resume()
+        {
+        }
+    };
+    //Suspends the task and continues it as a job, letting any worker (usually an idle one) pick it up
+    inline TaskScheduleAwaiter Schedule(JobSystem *system)
+    {
+        TaskScheduleAwaiter result;
+        result.system = system;
+        return result;
+    }
+
+    template<typename T>
+    struct TaskWhenAllAwaiter
+    {
+        JobSystem *system;
+        Task<T> *tasks;
+        usize count;
+        TaskWhenAllState state;
+
+        inline bool await_ready()
+        {
+            return count == 0;
+        }
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            state.parent = handle;
+            //one extra count held until every task is started, so the awaiting task cannot be resumed while still starting them
+            state.remaining = (i64)count + 1;
+            for (usize i = 0; i < count; i++)
+            {
+                TaskPromise<T> &promise = tasks[i].handle.promise();
+                promise.whenAll = &state;
+                promise.job = Job(&TaskResumeJob, tasks[i].handle.address());
+                RunJob(system, &promise.job, NULL);
+            }
+            //if every task already finished, carry on without suspending
+            return AtomicFetchAdd64(&state.remaining, -1, MemoryOrder_AcqRel) != 1;
+        }
+        inline void await_resume()
+        {
+        }
+    };
+    //Starts every task as a separate job and continues once all have finished. Results are read with Task::Result
+    template<typename T>
+    inline TaskWhenAllAwaiter<T> WhenAll(JobSystem *system, Task<T> *tasks, usize count)
+    {
+        TaskWhenAllAwaiter<T> result;
+        result.system = system;
+        result.tasks = tasks;
+        result.count = count;
+        return result;
+    }
+    template<typename T>
+    inline TaskWhenAllAwaiter<T> WhenAll(JobSystem *system, collections::vector<Task<T>> *tasks)
+    {
+        return WhenAll(system, tasks->ptr, tasks->count);
+    }
+
+    #define TASKEVENT_SET ((void*)1)
+
+    //A one shot signal that a single task can await. Set may be called from any thread, including ones outside the job system,
+    //and the waiting task then continues as a job. This is how completions from I/O or other threads are handed to tasks
+    struct TaskEvent
+    {
+        JobSystem *system;
+        //NULL while unset with no waiter, TASKEVENT_SET once set, or the waiting coroutine
+        void *volatile state;
+        Job job;
+
+        TaskEvent()
+        {
+            system = NULL;
+            state = NULL;
+            job = Job();
+        }
+        TaskEvent(JobSystem *system)
+        {
+            this->system = system;
+            state = NULL;
+            job = Job();
+        }
+        inline bool IsSet()
+        {
+            return AtomicLoadPointer(&state, MemoryOrder_Acquire) == TASKEVENT_SET;
+        }
+        void Set()
+        {
+            void *waiting = AtomicExchangePointer(&state, TASKEVENT_SET, MemoryOrder_AcqRel);
+            if (waiting != NULL && waiting != TASKEVENT_SET)
+            {
+                job = Job(&TaskResumeJob, waiting);
+                RunJob(system, &job, NULL);
+            }
+        }
+
+        inline bool await_ready()
+        {
+            return IsSet();
+        }
+        inline bool await_suspend(std::coroutine_handle<> handle)
+        {
+            void *expected = NULL;
+            //fails only if Set happened in between, in which case the task carries on
+            return AtomicCompareExchangePointer(&state, &expected, handle.address(), MemoryOrder_AcqRel);
+        }
+        inline void await_resume()
+        {
+        }
+    };
+
+    //Starts the task on the calling thread and helps run jobs until it has finished, then returns its result.
+    //This is the bridge from ordinary code into tasks, and should not be called from inside a task
+    template<typename T>
+    T RunTask(JobSystem *system, Task<T> *task)
+    {
+        JobCounter completion;
+        completion.pending = 1;
+        task->handle.promise().completion = &completion;
+        task->handle.resume();
+        WaitForCounter(system, &completion);
+        return task->Result();
+    }
+    //As above, then frees the task
+    template<typename T>
+    T RunTask(JobSystem *system, Task<T> task)
+    {
+        RunTask(system, &task);
+        T result = task.Result();
+        task.deinit();
+        return result;
+    }
+    inline void RunTask(JobSystem *system, Task<void> task)
+    {
+        RunTask(system, &task);
+        task.deinit();
+    }
+}
+#endif
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 #include "Linxc.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace threading
 {
@@ -10,8 +13,15 @@ namespace threading
 
     ConditionVariable CreateConditionVariable();
     void DestroyConditionVariable(ConditionVariable variable);
+    //Wakes one, or every, thread waiting on the variable
     void SetSignalled(ConditionVariable variable);
     void SetAllSignalled(ConditionVariable variable);
+    //Unlocks lock (which the caller must hold) and sleeps until signalled or until timeoutMilliseconds passes (0 waits forever),
+    //then locks it again before returning. Returns false on timeout.
+    //Wakeups can be spurious and signals sent before waiting are not remembered, so use WaitSignalledPredicate unless the caller loops itself
+    bool WaitSignalled(ConditionVariable variable, ThreadLock lock, u64 timeoutMilliseconds);
+    //Older interface that waits using the variable's own lock. AwaitSignalled returns with that lock held if it was signalled,
+    //which must then be released with ExitSignalled. Has the same spurious wakeup problems as WaitSignalled, with no way to tell
     void ExitSignalled(ConditionVariable variable);
     void AwaitSignalled(ConditionVariable variable, u64 timeout);
 
@@ -29,11 +39,933 @@ namespace threading
 #define THREAD_RESULT unsigned long
 #endif
 
+    enum ThreadPriority
+    {
+        ThreadPriority_Lowest,
+        ThreadPriority_Low,
+        ThreadPriority_Normal,
+        ThreadPriority_High,
+        ThreadPriority_Highest
+    };
+
     def_delegate(ThreadFunc, THREAD_RESULT, void*);
     Thread StartThread(ThreadFunc func, void *inputArgs);
+    //Blocks until the thread has returned from its function, then frees the thread handle
+    void JoinThread(Thread thread);
+    //As JoinThread, writing the value the thread's function returned to result
+    void JoinThread(Thread thread, THREAD_RESULT *result);
+    //Frees the thread handle without waiting. The thread keeps running and releases its own resources when it returns
+    void DetachThread(Thread thread);
+    //Forcibly stops the thread wherever it is, without unwinding or releasing anything it holds (including locks).
+    //Only for threads that cannot be asked to stop; prefer signalling the thread to return and joining it
     void ShutdownThread(Thread thread);
 
+    //Names show up in debuggers and profilers. Linux truncates names to 15 characters. Returns false where unsupported
+    bool SetThreadName(Thread thread, const char *name);
+    bool SetCurrentThreadName(const char *name);
+    //Restricts the thread to the CPUs set in cpuMask (bit i allowing CPU i, so only the first 64 CPUs can be chosen).
+    //Pinning a thread to one core stops the scheduler migrating it away from its warm caches.
+    //Returns false if the mask allows no available CPU or the platform has no affinity control (such as macOS)
+    bool SetThreadAffinity(Thread thread, u64 cpuMask);
+    bool SetCurrentThreadAffinity(u64 cpuMask);
+    //A hint to the scheduler. On Linux, Lowest and Low use the idle and batch policies and High and Highest
+    //the round robin real time policy, which needs CAP_SYS_NICE (or a raised RLIMIT_RTPRIO) and returns false without it
+    bool SetThreadPriority(Thread thread, ThreadPriority priority);
+    bool SetCurrentThreadPriority(ThreadPriority priority);
+
+    //Online logical processors, counting each SMT (hyperthread) sibling separately
     i32 GetCPUCount();
+
+    //The machine's processor and cache layout. Cache sizes are in bytes for one cache of that level as seen from a single core:
+    //L1 and L2 are usually private to a physical core while one L3 is shared by many. Anything that could not be found is 0
+    struct CPUTopology
+    {
+        //as GetCPUCount
+        i32 logicalCores;
+        //cores not counting SMT siblings. One busy thread per physical core avoids two threads competing for a core's caches and execution units
+        i32 physicalCores;
+        i32 packages;
+        i32 numaNodes;
+        u32 cacheLineSize;
+        u64 l1DataCacheSize;
+        u64 l1InstructionCacheSize;
+        u64 l2CacheSize;
+        u64 l3CacheSize;
+
+        CPUTopology()
+        {
+            logicalCores = 0;
+            physicalCores = 0;
+            packages = 0;
+            numaNodes = 0;
+            cacheLineSize = 0;
+            l1DataCacheSize = 0;
+            l1InstructionCacheSize = 0;
+            l2CacheSize = 0;
+            l3CacheSize = 0;
+        }
+    };
+    //Read from /sys on Linux (with cpuid filling in caches elsewhere on x86), sysctl on macOS and GetLogicalProcessorInformationEx on Windows.
+    //Much slower than GetCPUCount, so query it once and keep the result
+    CPUTopology GetCPUTopology();
+
+    //Milliseconds from an arbitrary starting point, unaffected by changes to the system clock
+    u64 GetMonotonicMilliseconds();
+
+    //Waits on the variable until predicate() returns true, with lock held whenever predicate is called.
+    //Returns false if timeoutMilliseconds (0 waits forever) passed with predicate still false
+    template<typename Predicate>
+    bool WaitSignalledPredicate(ConditionVariable variable, ThreadLock lock, Predicate predicate, u64 timeoutMilliseconds)
+    {
+        if (timeoutMilliseconds == 0)
+        {
+            while (!predicate())
+            {
+                WaitSignalled(variable, lock, 0);
+            }
+            return true;
+        }
+        u64 deadline = GetMonotonicMilliseconds() + timeoutMilliseconds;
+        while (!predicate())
+        {
+            u64 now = GetMonotonicMilliseconds();
+            if (now >= deadline)
+            {
+                return false;
+            }
+            WaitSignalled(variable, lock, deadline - now);
+        }
+        return true;
+    }
+
+    //Memory orderings, with the same meaning as in C11/C++11.
+    //Loads take Relaxed, Acquire or SeqCst, stores take Relaxed, Release or SeqCst, and read-modify-writes take any
+    enum MemoryOrder
+    {
+        MemoryOrder_Relaxed,
+        MemoryOrder_Acquire,
+        MemoryOrder_Release,
+        MemoryOrder_AcqRel,
+        MemoryOrder_SeqCst
+    };
+
+    //Atomic operations on naturally aligned 32 bit, 64 bit and pointer values. Overloads without an order are sequentially consistent.
+    //Fetch operations return the previous value, and compare exchanges write the current value to expected when they fail
+#ifdef _MSC_VER
+    //x86 and x64 only reorder stores after later loads, so plain loads and stores only need to stop the compiler reordering around them,
+    //while ARM needs real barriers: acquire loads are followed by one that orders earlier loads, and other loads and stores need a full one
+#if defined(_M_ARM64)
+#define ATOMIC_HARDWARE_BARRIER() __dmb(_ARM64_BARRIER_ISH)
+#define ATOMIC_ORDERING_BARRIER() __dmb(_ARM64_BARRIER_ISH)
+#define ATOMIC_ACQUIRE_BARRIER() __dmb(_ARM64_BARRIER_ISHLD)
+//Interlocked functions come in variants with no barrier (_nf), one sided barriers (_acq and _rel) and a full barrier, picked by order
+#define ATOMIC_INTERLOCKED(function, order, ...) ((order) == MemoryOrder_Relaxed ? function##_nf(__VA_ARGS__) \
+    : (order) == MemoryOrder_Acquire ? function##_acq(__VA_ARGS__) : (order) == MemoryOrder_Release ? function##_rel(__VA_ARGS__) : function(__VA_ARGS__))
+#else
+#define ATOMIC_HARDWARE_BARRIER() _mm_mfence()
+#define ATOMIC_ORDERING_BARRIER() _ReadWriteBarrier()
+#define ATOMIC_ACQUIRE_BARRIER() _ReadWriteBarrier()
+//the lock prefixed instructions behind Interlocked functions are full barriers, so every order gets the same one
+#define ATOMIC_INTERLOCKED(function, order, ...) ((void)(order), function(__VA_ARGS__))
+#endif
+    inline i32 AtomicLoad32(volatile i32 *target, MemoryOrder order)
+    {
+        i32 result = __iso_volatile_load32((volatile int*)target);
+        if (order == MemoryOrder_Acquire)
+        {
+            ATOMIC_ACQUIRE_BARRIER();
+        }
+        else if (order != MemoryOrder_Relaxed)
+        {
+            ATOMIC_ORDERING_BARRIER();
+        }
+        return result;
+    }
+    inline void AtomicStore32(volatile i32 *target, i32 value, MemoryOrder order)
+    {
+        if (order == MemoryOrder_SeqCst)
+        {
+            _InterlockedExchange((volatile long*)target, value);
+            return;
+        }
+        if (order != MemoryOrder_Relaxed)
+        {
+            ATOMIC_ORDERING_BARRIER();
+        }
+        __iso_volatile_store32((volatile int*)target, value);
+    }
+    inline i32 AtomicExchange32(volatile i32 *target, i32 value, MemoryOrder order)
+    {
+        return ATOMIC_INTERLOCKED(_InterlockedExchange, order, (volatile long*)target, value);
+    }
+    inline i32 AtomicFetchAdd32(volatile i32 *target, i32 value, MemoryOrder order)
+    {
+        return ATOMIC_INTERLOCKED(_InterlockedExchangeAdd, order, (volatile long*)target, value);
+    }
+    inline bool AtomicCompareExchange32(volatile i32 *target, i32 *expected, i32 desired, MemoryOrder order)
+    {
+        i32 previous = ATOMIC_INTERLOCKED(_InterlockedCompareExchange, order, (volatile long*)target, desired, *expected);
+        if (previous == *expected)
+        {
+            return true;
+        }
+        *expected = previous;
+        return false;
+    }
+
+    inline i64 AtomicLoad64(volatile i64 *target, MemoryOrder order)
+    {
+        i64 result = __iso_volatile_load64(target);
+        if (order == MemoryOrder_Acquire)
+        {
+            ATOMIC_ACQUIRE_BARRIER();
+        }
+        else if (order != MemoryOrder_Relaxed)
+        {
+            ATOMIC_ORDERING_BARRIER();
+        }
+        return result;
+    }
+    inline void AtomicStore64(volatile i64 *target, i64 value, MemoryOrder order)
+    {
+        if (order == MemoryOrder_SeqCst)
+        {
+            _InterlockedExchange64(target, value);
+            return;
+        }
+        if (order != MemoryOrder_Relaxed)
+        {
+            ATOMIC_ORDERING_BARRIER();
+        }
+        __iso_volatile_store64(target, value);
+    }
+    inline i64 AtomicExchange64(volatile i64 *target, i64 value, MemoryOrder order)
+    {
+        return ATOMIC_INTERLOCKED(_InterlockedExchange64, order, target, value);
+    }
+    inline i64 AtomicFetchAdd64(volatile i64 *target, i64 value, MemoryOrder order)
+    {
+        return ATOMIC_INTERLOCKED(_InterlockedExchangeAdd64, order, target, value);
+    }
+    inline bool AtomicCompareExchange64(volatile i64 *target, i64 *expected, i64 desired, MemoryOrder order)
+    {
+        i64 previous = ATOMIC_INTERLOCKED(_InterlockedCompareExchange64, order, target, desired, *expected);
+        if (previous == *expected)
+        {
+            return true;
+        }
+        *expected = previous;
+        return false;
+    }
+
+    inline void *AtomicLoadPointer(void *volatile *target, MemoryOrder order)
+    {
+        void *result = *target;
+        if (order == MemoryOrder_Acquire)
+        {
+            ATOMIC_ACQUIRE_BARRIER();
+        }
+        else if (order != MemoryOrder_Relaxed)
+        {
+            ATOMIC_ORDERING_BARRIER();
+        }
+        return result;
+    }
+    inline void AtomicStorePointer(void *volatile *target, void *value, MemoryOrder order)
+    {
+        if (order == MemoryOrder_SeqCst)
+        {
+            _InterlockedExchangePointer(target, value);
+            return;
+        }
+        if (order != MemoryOrder_Relaxed)
+        {
+            ATOMIC_ORDERING_BARRIER();
+        }
+        *target = value;
+    }
+    inline void *AtomicExchangePointer(void *volatile *target, void *value, MemoryOrder order)
+    {
+        return ATOMIC_INTERLOCKED(_InterlockedExchangePointer, order, target, value);
+    }
+    inline bool AtomicCompareExchangePointer(void *volatile *target, void **expected, void *desired, MemoryOrder order)
+    {
+        void *previous = ATOMIC_INTERLOCKED(_InterlockedCompareExchangePointer, order, target, desired, *expected);
+        if (previous == *expected)
+        {
+            return true;
+        }
+        *expected = previous;
+        return false;
+    }
+
+    inline void AtomicThreadFence(MemoryOrder order)
+    {
+        if (order == MemoryOrder_SeqCst)
+        {
+            ATOMIC_HARDWARE_BARRIER();
+        }
+        else if (order != MemoryOrder_Relaxed)
+        {
+            ATOMIC_ORDERING_BARRIER();
+        }
+    }
+    //Orders memory accesses against a signal handler on the same thread, which only constrains the compiler
+    inline void AtomicSignalFence(MemoryOrder)
+    {
+        _ReadWriteBarrier();
+    }
+    //Hints to the CPU that the thread is spin waiting
+    inline void SpinPause()
+    {
+#if defined(_M_ARM64)
+        __yield();
+#else
+        _mm_pause();
+#endif
+    }
+#else
+    inline int AtomicBuiltinOrder(MemoryOrder order)
+    {
+        switch (order)
+        {
+            case MemoryOrder_Relaxed:
+                return __ATOMIC_RELAXED;
+            case MemoryOrder_Acquire:
+                return __ATOMIC_ACQUIRE;
+            case MemoryOrder_Release:
+                return __ATOMIC_RELEASE;
+            case MemoryOrder_AcqRel:
+                return __ATOMIC_ACQ_REL;
+            default:
+                return __ATOMIC_SEQ_CST;
+        }
+    }
+    //the ordering of a failed compare exchange is a load, so it may not contain a release
+    inline int AtomicBuiltinFailureOrder(MemoryOrder order)
+    {
+        switch (order)
+        {
+            case MemoryOrder_Relaxed:
+            case MemoryOrder_Release:
+                return __ATOMIC_RELAXED;
+            case MemoryOrder_Acquire:
+            case MemoryOrder_AcqRel:
+                return __ATOMIC_ACQUIRE;
+            default:
+                return __ATOMIC_SEQ_CST;
+        }
+    }
+
+    inline i32 AtomicLoad32(volatile i32 *target, MemoryOrder order)
+    {
+        return __atomic_load_n(target, AtomicBuiltinOrder(order));
+    }
+    inline void AtomicStore32(volatile i32 *target, i32 value, MemoryOrder order)
+    {
+        __atomic_store_n(target, value, AtomicBuiltinOrder(order));
+    }
+    inline i32 AtomicExchange32(volatile i32 *target, i32 value, MemoryOrder order)
+    {
+        return __atomic_exchange_n(target, value, AtomicBuiltinOrder(order));
+    }
+    inline i32 AtomicFetchAdd32(volatile i32 *target, i32 value, MemoryOrder order)
+    {
+        return __atomic_fetch_add(target, value, AtomicBuiltinOrder(order));
+    }
+    inline bool AtomicCompareExchange32(volatile i32 *target, i32 *expected, i32 desired, MemoryOrder order)
+    {
+        return __atomic_compare_exchange_n(target, expected, desired, false, AtomicBuiltinOrder(order), AtomicBuiltinFailureOrder(order));
+    }
+
+    inline i64 AtomicLoad64(volatile i64 *target, MemoryOrder order)
+    {
+        return __atomic_load_n(target, AtomicBuiltinOrder(order));
+    }
+    inline void AtomicStore64(volatile i64 *target, i64 value, MemoryOrder order)
+    {
+        __atomic_store_n(target, value, AtomicBuiltinOrder(order));
+    }
+    inline i64 AtomicExchange64(volatile i64 *target, i64 value, MemoryOrder order)
+    {
+        return __atomic_exchange_n(target, value, AtomicBuiltinOrder(order));
+    }
+    inline i64 AtomicFetchAdd64(volatile i64 *target, i64 value, MemoryOrder order)
+    {
+        return __atomic_fetch_add(target, value, AtomicBuiltinOrder(order));
+    }
+    inline bool AtomicCompareExchange64(volatile i64 *target, i64 *expected, i64 desired, MemoryOrder order)
+    {
+        return __atomic_compare_exchange_n(target, expected, desired, false, AtomicBuiltinOrder(order), AtomicBuiltinFailureOrder(order));
+    }
+
+    inline void *AtomicLoadPointer(void *volatile *target, MemoryOrder order)
+    {
+        return __atomic_load_n(target, AtomicBuiltinOrder(order));
+    }
+    inline void AtomicStorePointer(void *volatile *target, void *value, MemoryOrder order)
+    {
+        __atomic_store_n(target, value, AtomicBuiltinOrder(order));
+    }
+    inline void *AtomicExchangePointer(void *volatile *target, void *value, MemoryOrder order)
+    {
+        return __atomic_exchange_n(target, value, AtomicBuiltinOrder(order));
+    }
+    inline bool AtomicCompareExchangePointer(void *volatile *target, void **expected, void *desired, MemoryOrder order)
+    {
+        return __atomic_compare_exchange_n(target, expected, desired, false, AtomicBuiltinOrder(order), AtomicBuiltinFailureOrder(order));
+    }
+
+    inline void AtomicThreadFence(MemoryOrder order)
+    {
+        __atomic_thread_fence(AtomicBuiltinOrder(order));
+    }
+    //Orders memory accesses against a signal handler on the same thread, which only constrains the compiler
+    inline void AtomicSignalFence(MemoryOrder order)
+    {
+        __atomic_signal_fence(AtomicBuiltinOrder(order));
+    }
+    //Hints to the CPU that the thread is spin waiting
+    inline void SpinPause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+#endif
+
+    inline i32 AtomicLoad32(volatile i32 *target) { return AtomicLoad32(target, MemoryOrder_SeqCst); }
+    inline void AtomicStore32(volatile i32 *target, i32 value) { AtomicStore32(target, value, MemoryOrder_SeqCst); }
+    inline i32 AtomicExchange32(volatile i32 *target, i32 value) { return AtomicExchange32(target, value, MemoryOrder_SeqCst); }
+    inline i32 AtomicFetchAdd32(volatile i32 *target, i32 value) { return AtomicFetchAdd32(target, value, MemoryOrder_SeqCst); }
+    inline bool AtomicCompareExchange32(volatile i32 *target, i32 *expected, i32 desired) { return AtomicCompareExchange32(target, expected, desired, MemoryOrder_SeqCst); }
+    inline i64 AtomicLoad64(volatile i64 *target) { return AtomicLoad64(target, MemoryOrder_SeqCst); }
+    inline void AtomicStore64(volatile i64 *target, i64 value) { AtomicStore64(target, value, MemoryOrder_SeqCst); }
+    inline i64 AtomicExchange64(volatile i64 *target, i64 value) { return AtomicExchange64(target, value, MemoryOrder_SeqCst); }
+    inline i64 AtomicFetchAdd64(volatile i64 *target, i64 value) { return AtomicFetchAdd64(target, value, MemoryOrder_SeqCst); }
+    inline bool AtomicCompareExchange64(volatile i64 *target, i64 *expected, i64 desired) { return AtomicCompareExchange64(target, expected, desired, MemoryOrder_SeqCst); }
+    inline void *AtomicLoadPointer(void *volatile *target) { return AtomicLoadPointer(target, MemoryOrder_SeqCst); }
+    inline void AtomicStorePointer(void *volatile *target, void *value) { AtomicStorePointer(target, value, MemoryOrder_SeqCst); }
+    inline void *AtomicExchangePointer(void *volatile *target, void *value) { return AtomicExchangePointer(target, value, MemoryOrder_SeqCst); }
+    inline bool AtomicCompareExchangePointer(void *volatile *target, void **expected, void *desired) { return AtomicCompareExchangePointer(target, expected, desired, MemoryOrder_SeqCst); }
+    inline void AtomicThreadFence() { AtomicThreadFence(MemoryOrder_SeqCst); }
+
+    //Blocks while *address equals expected, until woken or timeoutMilliseconds passes (0 waits forever).
+    //Returns false on timeout. Wakeups may be spurious, so callers re-check their condition in a loop.
+    //Uses futex on Linux, WaitOnAddress on Windows, __ulock_wait on macOS and _umtx_op on FreeBSD.
+    //Other POSIX systems sleep on one of a fixed set of pthread condition variables, chosen by hashing the address
+    bool FutexWait(volatile i32 *address, i32 expected, u64 timeoutMilliseconds);
+    void FutexWakeOne(volatile i32 *address);
+    void FutexWakeAll(volatile i32 *address);
+
+//Attempts to take a contended lock by spinning before the thread sleeps, since most critical sections are shorter than a context switch
+#ifndef LOCK_SPIN_COUNT
+#define LOCK_SPIN_COUNT 128
+#endif
+
+    //A mutex stored inline (no allocation), that costs one atomic operation to lock and one to unlock when uncontended.
+    //Contended threads spin briefly, then sleep on a futex. Not recursive. Zero initialised memory is an unlocked mutex
+    struct Mutex
+    {
+        //0 unlocked, 1 locked, 2 locked and threads may be sleeping
+        volatile i32 state;
+
+        Mutex()
+        {
+            state = 0;
+        }
+        inline bool TryLock()
+        {
+            i32 expected = 0;
+            return AtomicCompareExchange32(&state, &expected, 1, MemoryOrder_Acquire);
+        }
+        inline void Lock()
+        {
+            i32 expected = 0;
+            if (!AtomicCompareExchange32(&state, &expected, 1, MemoryOrder_Acquire))
+            {
+                LockContended();
+            }
+        }
+        void LockContended()
+        {
+            for (i32 i = 0; i < LOCK_SPIN_COUNT; i++)
+            {
+                if (AtomicLoad32(&state, MemoryOrder_Relaxed) == 0)
+                {
+                    i32 expected = 0;
+                    if (AtomicCompareExchange32(&state, &expected, 1, MemoryOrder_Acquire))
+                    {
+                        return;
+                    }
+                }
+                SpinPause();
+            }
+            //from here on the lock is marked as having sleepers, since this thread cannot tell whether others are
+            while (AtomicExchange32(&state, 2, MemoryOrder_Acquire) != 0)
+            {
+                FutexWait(&state, 2, 0);
+            }
+        }
+        inline void Unlock()
+        {
+            if (AtomicExchange32(&state, 0, MemoryOrder_Release) == 2)
+            {
+                FutexWakeOne(&state);
+            }
+        }
+    };
+
+    //A fair spinlock: threads take the lock in the order they arrived. Never sleeps, so only suits very short critical sections.
+    //Waiters yield their time slice after spinning for a while, since with more threads than cores the next thread in line may not be running
+    struct TicketLock
+    {
+        volatile i32 nextTicket;
+        volatile i32 nowServing;
+
+        TicketLock()
+        {
+            nextTicket = 0;
+            nowServing = 0;
+        }
+        inline bool TryLock()
+        {
+            i32 serving = AtomicLoad32(&nowServing, MemoryOrder_Relaxed);
+            i32 expected = serving;
+            return AtomicCompareExchange32(&nextTicket, &expected, serving + 1, MemoryOrder_Acquire);
+        }
+        inline void Lock()
+        {
+            i32 ticket = AtomicFetchAdd32(&nextTicket, 1, MemoryOrder_Relaxed);
+            for (i32 spins = 0; ; spins++)
+            {
+                i32 serving = AtomicLoad32(&nowServing, MemoryOrder_Acquire);
+                if (serving == ticket)
+                {
+                    return;
+                }
+                if (spins >= LOCK_SPIN_COUNT)
+                {
+                    YieldThread();
+                    continue;
+                }
+                //back off in proportion to the number of threads ahead, so that the lock's cache line is not hammered
+                for (i32 i = ticket - serving; i > 0; i--)
+                {
+                    SpinPause();
+                }
+            }
+        }
+        inline void Unlock()
+        {
+            AtomicStore32(&nowServing, AtomicLoad32(&nowServing, MemoryOrder_Relaxed) + 1, MemoryOrder_Release);
+        }
+    };
+
+#define RWLOCK_READER_MASK ((1 << 29) - 1)
+#define RWLOCK_WRITER (1 << 29)
+#define RWLOCK_WRITER_PENDING (1 << 30)
+
+    //A reader-writer lock for read-mostly data. Any number of readers may hold it at once, or a single writer.
+    //Waiting writers stop new readers from entering so that they cannot be starved. Spins briefly, then sleeps on a futex
+    struct RWLock
+    {
+        //reader count, RWLOCK_WRITER if a writer holds it, and RWLOCK_WRITER_PENDING while a writer is waiting
+        volatile i32 state;
+        //incremented whenever the lock is released, which is what sleeping threads wait on
+        volatile i32 sequence;
+        volatile i32 sleepers;
+
+        RWLock()
+        {
+            state = 0;
+            sequence = 0;
+            sleepers = 0;
+        }
+
+        inline bool TryReadLock()
+        {
+            i32 current = AtomicLoad32(&state, MemoryOrder_Relaxed);
+            return (current & (RWLOCK_WRITER | RWLOCK_WRITER_PENDING)) == 0 && AtomicCompareExchange32(&state, &current, current + 1, MemoryOrder_Acquire);
+        }
+        void ReadLock()
+        {
+            for (i32 spins = 0; ; spins++)
+            {
+                i32 current = AtomicLoad32(&state, MemoryOrder_Relaxed);
+                if ((current & (RWLOCK_WRITER | RWLOCK_WRITER_PENDING)) == 0)
+                {
+                    if (AtomicCompareExchange32(&state, &current, current + 1, MemoryOrder_Acquire))
+                    {
+                        return;
+                    }
+                    continue;
+                }
+                if (spins < LOCK_SPIN_COUNT)
+                {
+                    SpinPause();
+                }
+                else WaitForRelease(RWLOCK_WRITER | RWLOCK_WRITER_PENDING);
+            }
+        }
+        inline void ReadUnlock()
+        {
+            i32 previous = AtomicFetchAdd32(&state, -1, MemoryOrder_Release);
+            if ((previous & RWLOCK_READER_MASK) == 1)
+            {
+                Wake();
+            }
+        }
+
+        inline bool TryWriteLock()
+        {
+            i32 current = AtomicLoad32(&state, MemoryOrder_Relaxed);
+            return (current & ~RWLOCK_WRITER_PENDING) == 0 && AtomicCompareExchange32(&state, &current, RWLOCK_WRITER, MemoryOrder_Acquire);
+        }
+        void WriteLock()
+        {
+            for (i32 spins = 0; ; spins++)
+            {
+                i32 current = AtomicLoad32(&state, MemoryOrder_Relaxed);
+                if ((current & ~RWLOCK_WRITER_PENDING) == 0)
+                {
+                    //taking the lock clears the pending flag, other waiting writers set it again when they next look
+                    if (AtomicCompareExchange32(&state, &current, RWLOCK_WRITER, MemoryOrder_Acquire))
+                    {
+                        return;
+                    }
+                    continue;
+                }
+                if ((current & RWLOCK_WRITER_PENDING) == 0)
+                {
+                    AtomicCompareExchange32(&state, &current, current | RWLOCK_WRITER_PENDING, MemoryOrder_Relaxed);
+                    continue;
+                }
+                if (spins < LOCK_SPIN_COUNT)
+                {
+                    SpinPause();
+                }
+                else WaitForRelease(RWLOCK_WRITER | RWLOCK_READER_MASK);
+            }
+        }
+        inline void WriteUnlock()
+        {
+            AtomicFetchAdd32(&state, -RWLOCK_WRITER, MemoryOrder_Release);
+            Wake();
+        }
+
+        //sleeps until the lock is released, unless the bits in blockingMask were already cleared
+        void WaitForRelease(i32 blockingMask)
+        {
+            i32 currentSequence = AtomicLoad32(&sequence, MemoryOrder_Acquire);
+            AtomicFetchAdd32(&sleepers, 1);
+            if ((AtomicLoad32(&state) & blockingMask) != 0)
+            {
+                FutexWait(&sequence, currentSequence, 0);
+            }
+            AtomicFetchAdd32(&sleepers, -1, MemoryOrder_Relaxed);
+        }
+        inline void Wake()
+        {
+            AtomicFetchAdd32(&sequence, 1);
+            if (AtomicLoad32(&sleepers) != 0)
+            {
+                FutexWakeAll(&sequence);
+            }
+        }
+    };
+
+    //A flag that threads can wait on until another thread sets it, without a separate lock or condition variable.
+    //A manual reset event stays set and lets every waiter through until Reset is called,
+    //while an auto reset event lets a single waiter through per Set and then unsets itself
+    struct Event
+    {
+        //0 unset, 1 set, 2 unset with threads possibly sleeping on it
+        volatile i32 state;
+        bool autoReset;
+
+        Event()
+        {
+            state = 0;
+            autoReset = false;
+        }
+        Event(bool autoReset)
+        {
+            state = 0;
+            this->autoReset = autoReset;
+        }
+        inline void Set()
+        {
+            if (AtomicExchange32(&state, 1, MemoryOrder_Release) == 2)
+            {
+                //every sleeper is woken even when auto resetting, the ones that lose the race go back to sleep
+                FutexWakeAll(&state);
+            }
+        }
+        inline void Reset()
+        {
+            i32 expected = 1;
+            AtomicCompareExchange32(&state, &expected, 0, MemoryOrder_Relaxed);
+        }
+        inline bool IsSet()
+        {
+            return AtomicLoad32(&state, MemoryOrder_Acquire) == 1;
+        }
+        //Returns whether the event was set, consuming it if auto resetting, without waiting
+        inline bool TryWait()
+        {
+            if (autoReset)
+            {
+                i32 expected = 1;
+                return AtomicCompareExchange32(&state, &expected, 0, MemoryOrder_Acquire);
+            }
+            return IsSet();
+        }
+        //Returns false if timeoutMilliseconds (0 waits forever) passed before the event was set
+        bool Wait(u64 timeoutMilliseconds)
+        {
+            if (TryWait())
+            {
+                return true;
+            }
+            u64 deadline = timeoutMilliseconds == 0 ? 0 : GetMonotonicMilliseconds() + timeoutMilliseconds;
+            while (true)
+            {
+                i32 expected = 0;
+                AtomicCompareExchange32(&state, &expected, 2, MemoryOrder_Relaxed);
+                if (TryWait())
+                {
+                    return true;
+                }
+                u64 remaining = 0;
+                if (deadline != 0)
+                {
+                    u64 now = GetMonotonicMilliseconds();
+                    if (now >= deadline)
+                    {
+                        return false;
+                    }
+                    remaining = deadline - now;
+                }
+                FutexWait(&state, 2, remaining);
+                if (TryWait())
+                {
+                    return true;
+                }
+            }
+        }
+        inline void Wait()
+        {
+            Wait(0);
+        }
+    };
+
+    //A counting semaphore. Acquire takes one unit, waiting for one to be released if there are none,
+    //spinning briefly first so that a quick hand over between threads does not need to sleep and wake through the kernel
+    struct Semaphore
+    {
+        volatile i32 count;
+        volatile i32 sleepers;
+
+        Semaphore()
+        {
+            count = 0;
+            sleepers = 0;
+        }
+        Semaphore(i32 initialCount)
+        {
+            count = initialCount;
+            sleepers = 0;
+        }
+        inline bool TryAcquire()
+        {
+            i32 current = AtomicLoad32(&count, MemoryOrder_Relaxed);
+            while (current > 0)
+            {
+                if (AtomicCompareExchange32(&count, &current, current - 1, MemoryOrder_Acquire))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        //Returns false if timeoutMilliseconds (0 waits forever) passed without a unit being released
+        bool Acquire(u64 timeoutMilliseconds)
+        {
+            for (i32 i = 0; i < LOCK_SPIN_COUNT; i++)
+            {
+                if (TryAcquire())
+                {
+                    return true;
+                }
+                SpinPause();
+            }
+            u64 deadline = timeoutMilliseconds == 0 ? 0 : GetMonotonicMilliseconds() + timeoutMilliseconds;
+            AtomicFetchAdd32(&sleepers, 1);
+            bool acquired = false;
+            while (true)
+            {
+                i32 current = AtomicLoad32(&count);
+                while (current > 0 && !acquired)
+                {
+                    acquired = AtomicCompareExchange32(&count, &current, current - 1);
+                }
+                if (acquired)
+                {
+                    break;
+                }
+                u64 remaining = 0;
+                if (deadline != 0)
+                {
+                    u64 now = GetMonotonicMilliseconds();
+                    if (now >= deadline)
+                    {
+                        break;
+                    }
+                    remaining = deadline - now;
+                }
+                FutexWait(&count, 0, remaining);
+            }
+            AtomicFetchAdd32(&sleepers, -1, MemoryOrder_Relaxed);
+            return acquired;
+        }
+        inline void Acquire()
+        {
+            Acquire(0);
+        }
+        inline void Release(i32 units)
+        {
+            AtomicFetchAdd32(&count, units);
+            if (AtomicLoad32(&sleepers) != 0)
+            {
+                if (units == 1)
+                {
+                    FutexWakeOne(&count);
+                }
+                else FutexWakeAll(&count);
+            }
+        }
+        inline void Release()
+        {
+            Release(1);
+        }
+    };
+
+    //Makes a fixed number of threads wait for each other at the end of every phase of work. Reusable: as soon as the last thread
+    //arrives, every thread is released and the barrier is ready for the next phase. Waiting threads spin before sleeping
+    struct Barrier
+    {
+        i32 threadCount;
+        volatile i32 arrived;
+        //incremented each time the barrier opens, which is what waiting threads watch
+        volatile i32 generation;
+        volatile i32 sleepers;
+
+        Barrier()
+        {
+            threadCount = 0;
+            arrived = 0;
+            generation = 0;
+            sleepers = 0;
+        }
+        Barrier(i32 threadCount)
+        {
+            this->threadCount = threadCount;
+            arrived = 0;
+            generation = 0;
+            sleepers = 0;
+        }
+        //Returns true on exactly one of the threads of each phase (the last to arrive), which can be used for serial work between phases
+        bool ArriveAndWait()
+        {
+            i32 currentGeneration = AtomicLoad32(&generation, MemoryOrder_Acquire);
+            if (AtomicFetchAdd32(&arrived, 1, MemoryOrder_AcqRel) == threadCount - 1)
+            {
+                //no other thread can arrive again until the generation changes, so the count can be reset first
+                AtomicStore32(&arrived, 0, MemoryOrder_Relaxed);
+                AtomicFetchAdd32(&generation, 1);
+                if (AtomicLoad32(&sleepers) != 0)
+                {
+                    FutexWakeAll(&generation);
+                }
+                return true;
+            }
+            for (i32 i = 0; i < LOCK_SPIN_COUNT; i++)
+            {
+                if (AtomicLoad32(&generation, MemoryOrder_Acquire) != currentGeneration)
+                {
+                    return false;
+                }
+                SpinPause();
+            }
+            AtomicFetchAdd32(&sleepers, 1);
+            while (AtomicLoad32(&generation) == currentGeneration)
+            {
+                FutexWait(&generation, currentGeneration, 0);
+            }
+            AtomicFetchAdd32(&sleepers, -1, MemoryOrder_Relaxed);
+            return false;
+        }
+    };
+
+    //A single use countdown: threads wait until it has been counted down to zero, after which waits return immediately.
+    //Useful for waiting until a known number of tasks have finished, or for holding threads until initialisation is done
+    struct Latch
+    {
+        volatile i32 count;
+        volatile i32 sleepers;
+
+        Latch()
+        {
+            count = 0;
+            sleepers = 0;
+        }
+        Latch(i32 count)
+        {
+            this->count = count;
+            sleepers = 0;
+        }
+        inline void CountDown(i32 amount)
+        {
+            if (AtomicFetchAdd32(&count, -amount) == amount && AtomicLoad32(&sleepers) != 0)
+            {
+                FutexWakeAll(&count);
+            }
+        }
+        inline void CountDown()
+        {
+            CountDown(1);
+        }
+        inline bool TryWait()
+        {
+            return AtomicLoad32(&count, MemoryOrder_Acquire) == 0;
+        }
+        void Wait()
+        {
+            for (i32 i = 0; i < LOCK_SPIN_COUNT; i++)
+            {
+                if (TryWait())
+                {
+                    return;
+                }
+                SpinPause();
+            }
+            AtomicFetchAdd32(&sleepers, 1);
+            i32 current;
+            while ((current = AtomicLoad32(&count)) != 0)
+            {
+                FutexWait(&count, current, 0);
+            }
+            AtomicFetchAdd32(&sleepers, -1, MemoryOrder_Relaxed);
+        }
+        inline void ArriveAndWait()
+        {
+            CountDown(1);
+            Wait();
+        }
+    };
 }
 
 #ifdef ASTRALCORE_THREADING_IMPL
@@ -43,6 +975,10 @@ namespace threading
 #ifdef WINDOWS
 #define WIN32_LEAN_AND_MEAN
 #include "windows.h"
+#ifdef _MSC_VER
+//WaitOnAddress and WakeByAddress
+#pragma comment(lib, "Synchronization.lib")
+#endif
 
 namespace threading
 {
@@ -88,6 +1024,14 @@ namespace threading
     {
         LeaveCriticalSection(&variable->criticalSection);
     }
+    bool WaitSignalled(ConditionVariable variable, ThreadLock lock, u64 timeoutMilliseconds)
+    {
+        if (!SleepConditionVariableCS(&variable->handle, &lock->handle, timeoutMilliseconds == 0 ? INFINITE : (DWORD)timeoutMilliseconds))
+        {
+            return GetLastError() != ERROR_TIMEOUT;
+        }
+        return true;
+    }
     void AwaitSignalled(ConditionVariable variable, u64 timeout)
     {
         EnterCriticalSection(&variable->criticalSection);
@@ -128,23 +1072,204 @@ namespace threading
         thread->handle = CreateThread(NULL, 0, func, inputArgs, 0, NULL);
         return thread;
     }
+    void JoinThread(Thread thread)
+    {
+        WaitForSingleObject(thread->handle, INFINITE);
+        CloseHandle(thread->handle);
+        free(thread);
+    }
+    void JoinThread(Thread thread, THREAD_RESULT *result)
+    {
+        WaitForSingleObject(thread->handle, INFINITE);
+        DWORD exitCode = 0;
+        GetExitCodeThread(thread->handle, &exitCode);
+        *result = (THREAD_RESULT)exitCode;
+        CloseHandle(thread->handle);
+        free(thread);
+    }
+    void DetachThread(Thread thread)
+    {
+        CloseHandle(thread->handle);
+        free(thread);
+    }
     void ShutdownThread(Thread thread)
     {
         TerminateThread(thread->handle, 0);
         free(thread);
     }
+
+    def_delegate(SetThreadDescriptionFunc, HRESULT, HANDLE, PCWSTR);
+    bool SetThreadNameWindows(HANDLE handle, const char *name)
+    {
+        //SetThreadDescription only exists from Windows 10 1607, so it is looked up rather than linked
+        SetThreadDescriptionFunc setThreadDescription = (SetThreadDescriptionFunc)GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription");
+        if (setThreadDescription == NULL)
+        {
+            return false;
+        }
+        wchar_t wideName[256];
+        if (MultiByteToWideChar(CP_UTF8, 0, name, -1, wideName, 256) == 0)
+        {
+            return false;
+        }
+        return SUCCEEDED(setThreadDescription(handle, wideName));
+    }
+    bool SetThreadName(Thread thread, const char *name)
+    {
+        return SetThreadNameWindows(thread->handle, name);
+    }
+    bool SetCurrentThreadName(const char *name)
+    {
+        return SetThreadNameWindows(GetCurrentThread(), name);
+    }
+    bool SetThreadAffinity(Thread thread, u64 cpuMask)
+    {
+        return SetThreadAffinityMask(thread->handle, (DWORD_PTR)cpuMask) != 0;
+    }
+    bool SetCurrentThreadAffinity(u64 cpuMask)
+    {
+        return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cpuMask) != 0;
+    }
+    bool SetThreadPriorityWindows(HANDLE handle, ThreadPriority priority)
+    {
+        int values[] = { THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST };
+        return ::SetThreadPriority(handle, values[priority]) != 0;
+    }
+    bool SetThreadPriority(Thread thread, ThreadPriority priority)
+    {
+        return SetThreadPriorityWindows(thread->handle, priority);
+    }
+    bool SetCurrentThreadPriority(ThreadPriority priority)
+    {
+        return SetThreadPriorityWindows(GetCurrentThread(), priority);
+    }
     i32 GetCPUCount()
     {
         SYSTEM_INFO sysInfo;
         GetSystemInfo(&sysInfo);
         return sysInfo.dwNumberOfProcessors;
     }
+    CPUTopology GetCPUTopology()
+    {
+        CPUTopology result;
+        DWORD length = 0;
+        GetLogicalProcessorInformationEx(RelationAll, NULL, &length);
+        u8 *buffer = (u8*)malloc(length);
+        if (buffer != NULL && GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer, &length))
+        {
+            DWORD offset = 0;
+            while (offset < length)
+            {
+                PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(buffer + offset);
+                if (info->Relationship == RelationProcessorCore)
+                {
+                    result.physicalCores++;
+                    for (WORD i = 0; i < info->Processor.GroupCount; i++)
+                    {
+                        for (KAFFINITY mask = info->Processor.GroupMask[i].Mask; mask != 0; mask &= mask - 1)
+                        {
+                            result.logicalCores++;
+                        }
+                    }
+                }
+                else if (info->Relationship == RelationProcessorPackage)
+                {
+                    result.packages++;
+                }
+                else if (info->Relationship == RelationNumaNode)
+                {
+                    result.numaNodes++;
+                }
+                else if (info->Relationship == RelationCache)
+                {
+                    CACHE_RELATIONSHIP *cache = &info->Cache;
+                    result.cacheLineSize = cache->LineSize;
+                    if (cache->Level == 1 && cache->Type == CacheData)
+                    {
+                        result.l1DataCacheSize = cache->CacheSize;
+                    }
+                    else if (cache->Level == 1 && cache->Type == CacheInstruction)
+                    {
+                        result.l1InstructionCacheSize = cache->CacheSize;
+                    }
+                    else if (cache->Level == 2)
+                    {
+                        result.l2CacheSize = cache->CacheSize;
+                    }
+                    else if (cache->Level == 3)
+                    {
+                        result.l3CacheSize = cache->CacheSize;
+                    }
+                }
+                offset += info->Size;
+            }
+        }
+        free(buffer);
+        if (result.logicalCores == 0)
+        {
+            result.logicalCores = GetCPUCount();
+        }
+        if (result.physicalCores == 0)
+        {
+            result.physicalCores = result.logicalCores;
+        }
+        return result;
+    }
+    u64 GetMonotonicMilliseconds()
+    {
+        return GetTickCount64();
+    }
+
+    bool FutexWait(volatile i32 *address, i32 expected, u64 timeoutMilliseconds)
+    {
+        if (!WaitOnAddress(address, &expected, sizeof(i32), timeoutMilliseconds == 0 ? INFINITE : (DWORD)timeoutMilliseconds))
+        {
+            return GetLastError() != ERROR_TIMEOUT;
+        }
+        return true;
+    }
+    void FutexWakeOne(volatile i32 *address)
+    {
+        WakeByAddressSingle((PVOID)address);
+    }
+    void FutexWakeAll(volatile i32 *address)
+    {
+        WakeByAddressAll((PVOID)address);
+    }
 }
 
 #endif
 #ifdef POSIX
 #include <pthread.h>
 #include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <stdio.h>
+#endif
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#include <sys/umtx.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#ifdef __APPLE__
+//not in the SDK's headers, but exported by libSystem since macOS 10.12 and used by the C++ runtime's own atomic waits
+extern "C" int __ulock_wait(u32 operation, void *address, u64 value, u32 timeoutMicroseconds);
+extern "C" int __ulock_wake(u32 operation, void *address, u64 wakeValue);
+#define ULOCK_COMPARE_AND_WAIT 1
+#define ULOCK_WAKE_ALL 0x00000100
+#define ULOCK_NO_ERRNO 0x01000000
+#endif
 
 namespace threading
 {
@@ -164,14 +1289,43 @@ namespace threading
 
     ConditionVariable CreateConditionVariable()
     {
-        ConditionVariableImpl result;
-        pthread_cond_init(&result.handle, NULL);
-        pthread_mutex_init(&result.mutex, NULL);
-
         ConditionVariable ptr = (ConditionVariable)malloc(sizeof(ConditionVariableImpl));
-        *ptr = result;
+        pthread_condattr_t attributes;
+        pthread_condattr_init(&attributes);
+#ifndef __APPLE__
+        //time out against the monotonic clock so that changes to the system time do not stretch or cut short waits
+        pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+#endif
+        pthread_cond_init(&ptr->handle, &attributes);
+        pthread_condattr_destroy(&attributes);
+        pthread_mutex_init(&ptr->mutex, NULL);
         return ptr;
     }
+    //returns the result of the pthread wait, ETIMEDOUT on timeout
+    int ConditionTimedWait(pthread_cond_t *condition, pthread_mutex_t *mutex, u64 timeoutMilliseconds)
+    {
+        if (timeoutMilliseconds == 0)
+        {
+            return pthread_cond_wait(condition, mutex);
+        }
+#ifdef __APPLE__
+        struct timespec relative;
+        relative.tv_sec = (time_t)(timeoutMilliseconds / 1000);
+        relative.tv_nsec = (long)((timeoutMilliseconds % 1000) * 1000000);
+        return pthread_cond_timedwait_relative_np(condition, mutex, &relative);
+#else
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += (time_t)(timeoutMilliseconds / 1000);
+        deadline.tv_nsec += (long)((timeoutMilliseconds % 1000) * 1000000);
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        return pthread_cond_timedwait(condition, mutex, &deadline);
+#endif
+    }
     void DestroyConditionVariable(ConditionVariable variable)
     {
         pthread_mutex_destroy(&variable->mutex);
@@ -194,14 +1348,22 @@ namespace threading
     {
         pthread_mutex_unlock(&variable->mutex);
     }
+    bool WaitSignalled(ConditionVariable variable, ThreadLock lock, u64 timeoutMilliseconds)
+    {
+        return ConditionTimedWait(&variable->handle, &lock->handle, timeoutMilliseconds) != ETIMEDOUT;
+    }
     void AwaitSignalled(ConditionVariable variable, u64 timeout)
     {
         pthread_mutex_lock(&variable->mutex);
-        if (pthread_cond_wait(&variable->handle, &variable->mutex) != 0)
+        if (ConditionTimedWait(&variable->handle, &variable->mutex, timeout) != 0)
         {
             pthread_mutex_unlock(&variable->mutex);
         }
     }
+    void YieldThread()
+    {
+        sched_yield();
+    }
 
     ThreadLock CreateThreadLock()
     {
@@ -229,20 +1391,538 @@ namespace threading
         pthread_create(&thread->handle, NULL, func, inputArgs);
         return thread;
     }
+    void JoinThread(Thread thread)
+    {
+        pthread_join(thread->handle, NULL);
+        free(thread);
+    }
+    void JoinThread(Thread thread, THREAD_RESULT *result)
+    {
+        pthread_join(thread->handle, result);
+        free(thread);
+    }
+    void DetachThread(Thread thread)
+    {
+        pthread_detach(thread->handle);
+        free(thread);
+    }
     void ShutdownThread(Thread thread)
     {
         pthread_cancel(thread->handle);
         free(thread);
     }
 
-    #ifndef BSD
+    bool SetThreadNamePosix(pthread_t handle, const char *name)
+    {
+#if defined(__linux__)
+        //names longer than 15 characters are rejected rather than truncated, so cut them short here
+        char shortName[16];
+        usize length = 0;
+        while (length < 15 && name[length] != 0)
+        {
+            shortName[length] = name[length];
+            length++;
+        }
+        shortName[length] = 0;
+        return pthread_setname_np(handle, shortName) == 0;
+#elif defined(__APPLE__)
+        //macOS can only name the calling thread
+        if (!pthread_equal(handle, pthread_self()))
+        {
+            return false;
+        }
+        return pthread_setname_np(name) == 0;
+#else
+        return false;
+#endif
+    }
+    bool SetThreadName(Thread thread, const char *name)
+    {
+        return SetThreadNamePosix(thread->handle, name);
+    }
+    bool SetCurrentThreadName(const char *name)
+    {
+        return SetThreadNamePosix(pthread_self(), name);
+    }
+    bool SetThreadAffinityPosix(pthread_t handle, u64 cpuMask)
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (i32 i = 0; i < 64; i++)
+        {
+            if (cpuMask & ((u64)1 << i))
+            {
+                CPU_SET(i, &set);
+            }
+        }
+        return pthread_setaffinity_np(handle, sizeof(cpu_set_t), &set) == 0;
+#else
+        return false;
+#endif
+    }
+    bool SetThreadAffinity(Thread thread, u64 cpuMask)
+    {
+        return SetThreadAffinityPosix(thread->handle, cpuMask);
+    }
+    bool SetCurrentThreadAffinity(u64 cpuMask)
+    {
+        return SetThreadAffinityPosix(pthread_self(), cpuMask);
+    }
+    bool SetThreadPriorityPosix(pthread_t handle, ThreadPriority priority)
+    {
+        struct sched_param parameters;
+        parameters.sched_priority = 0;
+#if defined(__linux__)
+        //SCHED_OTHER threads all have the same static priority on Linux, so the hint picks a policy instead
+        int policy = SCHED_OTHER;
+        switch (priority)
+        {
+            case ThreadPriority_Lowest:
+                policy = SCHED_IDLE;
+                break;
+            case ThreadPriority_Low:
+                policy = SCHED_BATCH;
+                break;
+            case ThreadPriority_High:
+                policy = SCHED_RR;
+                parameters.sched_priority = sched_get_priority_min(SCHED_RR);
+                break;
+            case ThreadPriority_Highest:
+                policy = SCHED_RR;
+                parameters.sched_priority = (sched_get_priority_min(SCHED_RR) + sched_get_priority_max(SCHED_RR)) / 2;
+                break;
+            default:
+                break;
+        }
+        return pthread_setschedparam(handle, policy, &parameters) == 0;
+#else
+        int minimum = sched_get_priority_min(SCHED_OTHER);
+        int maximum = sched_get_priority_max(SCHED_OTHER);
+        parameters.sched_priority = minimum + ((maximum - minimum) * (int)priority) / (int)ThreadPriority_Highest;
+        return pthread_setschedparam(handle, SCHED_OTHER, &parameters) == 0;
+#endif
+    }
+    bool SetThreadPriority(Thread thread, ThreadPriority priority)
+    {
+        return SetThreadPriorityPosix(thread->handle, priority);
+    }
+    bool SetCurrentThreadPriority(ThreadPriority priority)
+    {
+        return SetThreadPriorityPosix(pthread_self(), priority);
+    }
+
     i32 GetCPUCount()
     {
-        return sysconf(_SC_NPROCESSORS_ONLN);
+        //supported by Linux, macOS and the BSDs alike
+        return (i32)sysconf(_SC_NPROCESSORS_ONLN);
     }
-    #else
-    #error "GetCPUCount() not implemented for BSD devices"
-    #endif
+
+#if defined(__x86_64__) || defined(__i386__)
+    //fills in any cache sizes still unknown from the deterministic cache parameters, leaf 4 on Intel or 0x8000001D on AMD
+    void CPUTopologyReadCpuid(CPUTopology *topology)
+    {
+        u32 eax, ebx, ecx, edx;
+        u32 leaf = 4;
+        __cpuid(0, eax, ebx, ecx, edx);
+        bool hasLeaf4 = eax >= 4;
+        if (hasLeaf4)
+        {
+            //AMD reports no caches through leaf 4
+            __cpuid_count(4, 0, eax, ebx, ecx, edx);
+            hasLeaf4 = (eax & 31) != 0;
+        }
+        if (!hasLeaf4)
+        {
+            __cpuid(0x80000000, eax, ebx, ecx, edx);
+            if (eax < 0x8000001D)
+            {
+                return;
+            }
+            leaf = 0x8000001D;
+        }
+        for (u32 index = 0; index < 16; index++)
+        {
+            __cpuid_count(leaf, index, eax, ebx, ecx, edx);
+            u32 type = eax & 31;
+            if (type == 0)
+            {
+                break;
+            }
+            u32 level = (eax >> 5) & 7;
+            u32 lineSize = (ebx & 0xFFF) + 1;
+            u64 size = (u64)(((ebx >> 22) & 0x3FF) + 1) * (((ebx >> 12) & 0x3FF) + 1) * lineSize * ((u64)ecx + 1);
+            if (topology->cacheLineSize == 0)
+            {
+                topology->cacheLineSize = lineSize;
+            }
+            if (level == 1 && type == 1 && topology->l1DataCacheSize == 0)
+            {
+                topology->l1DataCacheSize = size;
+            }
+            else if (level == 1 && type == 2 && topology->l1InstructionCacheSize == 0)
+            {
+                topology->l1InstructionCacheSize = size;
+            }
+            else if (level == 2 && topology->l2CacheSize == 0)
+            {
+                topology->l2CacheSize = size;
+            }
+            else if (level == 3 && topology->l3CacheSize == 0)
+            {
+                topology->l3CacheSize = size;
+            }
+        }
+    }
+#endif
+
+#if defined(__linux__)
+    //reads a small text file such as those in /sys, returning false if it does not exist
+    bool CPUTopologyReadFile(const char *path, char *buffer, usize bufferSize)
+    {
+        int file = open(path, O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+        ssize_t length = read(file, buffer, bufferSize - 1);
+        close(file);
+        if (length < 0)
+        {
+            return false;
+        }
+        buffer[length] = 0;
+        return true;
+    }
+    //parses a number with an optional K or M suffix (as cache sizes are given), advancing cursor past it
+    u64 CPUTopologyParseNumber(const char **cursor)
+    {
+        u64 result = 0;
+        const char *c = *cursor;
+        while (*c >= '0' && *c <= '9')
+        {
+            result = result * 10 + (u64)(*c - '0');
+            c++;
+        }
+        if (*c == 'K')
+        {
+            result *= 1024;
+            c++;
+        }
+        else if (*c == 'M')
+        {
+            result *= 1024 * 1024;
+            c++;
+        }
+        *cursor = c;
+        return result;
+    }
+    u64 CPUTopologyReadNumber(const char *path)
+    {
+        char buffer[64];
+        if (!CPUTopologyReadFile(path, buffer, 64))
+        {
+            return 0;
+        }
+        const char *cursor = buffer;
+        return CPUTopologyParseNumber(&cursor);
+    }
+    //counts the entries of a list such as "0-3,8,10-11"
+    i32 CPUTopologyCountList(const char *path)
+    {
+        char buffer[1024];
+        if (!CPUTopologyReadFile(path, buffer, 1024))
+        {
+            return 0;
+        }
+        i32 count = 0;
+        const char *cursor = buffer;
+        while (*cursor >= '0' && *cursor <= '9')
+        {
+            u64 first = CPUTopologyParseNumber(&cursor);
+            u64 last = first;
+            if (*cursor == '-')
+            {
+                cursor++;
+                last = CPUTopologyParseNumber(&cursor);
+            }
+            count += (i32)(last - first + 1);
+            if (*cursor == ',')
+            {
+                cursor++;
+            }
+        }
+        return count;
+    }
+
+    CPUTopology GetCPUTopology()
+    {
+        CPUTopology result;
+        result.logicalCores = GetCPUCount();
+        char path[128];
+        char buffer[64];
+        i32 configuredCores = (i32)sysconf(_SC_NPROCESSORS_CONF);
+        for (i32 cpu = 0; cpu < configuredCores; cpu++)
+        {
+            //offline processors have no topology
+            snprintf(path, 128, "/sys/devices/system/cpu/cpu%i/online", cpu);
+            if (CPUTopologyReadFile(path, buffer, 64) && buffer[0] == '0')
+            {
+                continue;
+            }
+            //each core and package is counted by its lowest numbered processor, the first in its list of siblings
+            snprintf(path, 128, "/sys/devices/system/cpu/cpu%i/topology/thread_siblings_list", cpu);
+            if (CPUTopologyReadFile(path, buffer, 64))
+            {
+                const char *cursor = buffer;
+                if (CPUTopologyParseNumber(&cursor) == (u64)cpu)
+                {
+                    result.physicalCores++;
+                }
+            }
+            snprintf(path, 128, "/sys/devices/system/cpu/cpu%i/topology/core_siblings_list", cpu);
+            if (CPUTopologyReadFile(path, buffer, 64))
+            {
+                const char *cursor = buffer;
+                if (CPUTopologyParseNumber(&cursor) == (u64)cpu)
+                {
+                    result.packages++;
+                }
+            }
+        }
+        for (i32 index = 0; ; index++)
+        {
+            snprintf(path, 128, "/sys/devices/system/cpu/cpu0/cache/index%i/type", index);
+            if (!CPUTopologyReadFile(path, buffer, 64))
+            {
+                break;
+            }
+            char type = buffer[0];
+            snprintf(path, 128, "/sys/devices/system/cpu/cpu0/cache/index%i/level", index);
+            u64 level = CPUTopologyReadNumber(path);
+            snprintf(path, 128, "/sys/devices/system/cpu/cpu0/cache/index%i/size", index);
+            u64 size = CPUTopologyReadNumber(path);
+            snprintf(path, 128, "/sys/devices/system/cpu/cpu0/cache/index%i/coherency_line_size", index);
+            u64 lineSize = CPUTopologyReadNumber(path);
+            if (lineSize != 0)
+            {
+                result.cacheLineSize = (u32)lineSize;
+            }
+            //type is one of Data, Instruction or Unified
+            if (level == 1 && type == 'D')
+            {
+                result.l1DataCacheSize = size;
+            }
+            else if (level == 1 && type == 'I')
+            {
+                result.l1InstructionCacheSize = size;
+            }
+            else if (level == 2)
+            {
+                result.l2CacheSize = size;
+            }
+            else if (level == 3)
+            {
+                result.l3CacheSize = size;
+            }
+        }
+        result.numaNodes = CPUTopologyCountList("/sys/devices/system/node/online");
+#if defined(__x86_64__) || defined(__i386__)
+        CPUTopologyReadCpuid(&result);
+#endif
+        if (result.physicalCores == 0)
+        {
+            result.physicalCores = result.logicalCores;
+        }
+        if (result.packages == 0)
+        {
+            result.packages = 1;
+        }
+        if (result.numaNodes == 0)
+        {
+            result.numaNodes = 1;
+        }
+        return result;
+    }
+#elif defined(__APPLE__)
+    u64 CPUTopologyReadSysctl(const char *name)
+    {
+        u64 value = 0;
+        usize size = sizeof(u64);
+        if (sysctlbyname(name, &value, &size, NULL, 0) != 0)
+        {
+            return 0;
+        }
+        //some entries are 32 bit, which fill only the low half on little endian machines
+        return size == sizeof(u32) ? (u64)(u32)value : value;
+    }
+    CPUTopology GetCPUTopology()
+    {
+        CPUTopology result;
+        result.logicalCores = GetCPUCount();
+        result.physicalCores = (i32)CPUTopologyReadSysctl("hw.physicalcpu");
+        result.packages = (i32)CPUTopologyReadSysctl("hw.packages");
+        result.numaNodes = 1;
+        result.cacheLineSize = (u32)CPUTopologyReadSysctl("hw.cachelinesize");
+        //on Apple silicon these describe the performance cores
+        result.l1DataCacheSize = CPUTopologyReadSysctl("hw.l1dcachesize");
+        result.l1InstructionCacheSize = CPUTopologyReadSysctl("hw.l1icachesize");
+        result.l2CacheSize = CPUTopologyReadSysctl("hw.l2cachesize");
+        result.l3CacheSize = CPUTopologyReadSysctl("hw.l3cachesize");
+        if (result.physicalCores == 0)
+        {
+            result.physicalCores = result.logicalCores;
+        }
+        if (result.packages == 0)
+        {
+            result.packages = 1;
+        }
+        return result;
+    }
+#else
+    CPUTopology GetCPUTopology()
+    {
+        CPUTopology result;
+        result.logicalCores = GetCPUCount();
+        result.physicalCores = result.logicalCores;
+        result.packages = 1;
+        result.numaNodes = 1;
+#if defined(__x86_64__) || defined(__i386__)
+        CPUTopologyReadCpuid(&result);
+#endif
+        return result;
+    }
+#endif
+    u64 GetMonotonicMilliseconds()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (u64)now.tv_sec * 1000 + (u64)now.tv_nsec / 1000000;
+    }
+
+#ifdef __linux__
+    bool FutexWait(volatile i32 *address, i32 expected, u64 timeoutMilliseconds)
+    {
+        struct timespec timeout;
+        struct timespec *timeoutPtr = NULL;
+        if (timeoutMilliseconds != 0)
+        {
+            timeout.tv_sec = (time_t)(timeoutMilliseconds / 1000);
+            timeout.tv_nsec = (long)((timeoutMilliseconds % 1000) * 1000000);
+            timeoutPtr = &timeout;
+        }
+        long result = syscall(SYS_futex, (i32*)address, FUTEX_WAIT_PRIVATE, expected, timeoutPtr, NULL, 0);
+        return !(result == -1 && errno == ETIMEDOUT);
+    }
+    void FutexWakeOne(volatile i32 *address)
+    {
+        syscall(SYS_futex, (i32*)address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+    void FutexWakeAll(volatile i32 *address)
+    {
+        syscall(SYS_futex, (i32*)address, FUTEX_WAKE_PRIVATE, 0x7FFFFFFF, NULL, NULL, 0);
+    }
+#elif defined(__APPLE__)
+    bool FutexWait(volatile i32 *address, i32 expected, u64 timeoutMilliseconds)
+    {
+        //the timeout is in 32 bit microseconds, so longer waits wake early and are reported as spurious for the caller to wait again
+        u32 timeout = 0;
+        bool clamped = false;
+        if (timeoutMilliseconds != 0)
+        {
+            clamped = timeoutMilliseconds > 0xFFFFFFFFull / 1000;
+            timeout = clamped ? 0xFFFFFFFF : (u32)(timeoutMilliseconds * 1000);
+        }
+        int result = __ulock_wait(ULOCK_COMPARE_AND_WAIT | ULOCK_NO_ERRNO, (void*)address, (u64)(u32)expected, timeout);
+        return !(result == -ETIMEDOUT && !clamped);
+    }
+    void FutexWakeOne(volatile i32 *address)
+    {
+        __ulock_wake(ULOCK_COMPARE_AND_WAIT | ULOCK_NO_ERRNO, (void*)address, 0);
+    }
+    void FutexWakeAll(volatile i32 *address)
+    {
+        __ulock_wake(ULOCK_COMPARE_AND_WAIT | ULOCK_WAKE_ALL | ULOCK_NO_ERRNO, (void*)address, 0);
+    }
+#elif defined(__FreeBSD__)
+    bool FutexWait(volatile i32 *address, i32 expected, u64 timeoutMilliseconds)
+    {
+        //with no size given, the timeout is a relative timespec
+        struct timespec timeout;
+        struct timespec *timeoutPtr = NULL;
+        if (timeoutMilliseconds != 0)
+        {
+            timeout.tv_sec = (time_t)(timeoutMilliseconds / 1000);
+            timeout.tv_nsec = (long)((timeoutMilliseconds % 1000) * 1000000);
+            timeoutPtr = &timeout;
+        }
+        int result = _umtx_op((void*)address, UMTX_OP_WAIT_UINT_PRIVATE, (u_long)(u32)expected, NULL, timeoutPtr);
+        return !(result == -1 && errno == ETIMEDOUT);
+    }
+    void FutexWakeOne(volatile i32 *address)
+    {
+        _umtx_op((void*)address, UMTX_OP_WAKE_PRIVATE, 1, NULL, NULL);
+    }
+    void FutexWakeAll(volatile i32 *address)
+    {
+        _umtx_op((void*)address, UMTX_OP_WAKE_PRIVATE, 0x7FFFFFFF, NULL, NULL);
+    }
+#else
+    //Addresses share a fixed set of parking spots. Waiters check the address under the spot's mutex, and wakers take that mutex
+    //before waking, so a wake between the check and the sleep cannot be missed
+#define FUTEX_PARKING_SPOTS 64
+    struct FutexParkingSpot
+    {
+        pthread_mutex_t mutex;
+        pthread_cond_t condition;
+    };
+    static FutexParkingSpot futexParkingSpots[FUTEX_PARKING_SPOTS];
+    static pthread_once_t futexParkingSpotsOnce = PTHREAD_ONCE_INIT;
+
+    void InitFutexParkingSpots()
+    {
+        pthread_condattr_t attributes;
+        pthread_condattr_init(&attributes);
+        pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+        for (usize i = 0; i < FUTEX_PARKING_SPOTS; i++)
+        {
+            pthread_mutex_init(&futexParkingSpots[i].mutex, NULL);
+            pthread_cond_init(&futexParkingSpots[i].condition, &attributes);
+        }
+        pthread_condattr_destroy(&attributes);
+    }
+    FutexParkingSpot *FutexParkingSpotOf(volatile i32 *address)
+    {
+        pthread_once(&futexParkingSpotsOnce, &InitFutexParkingSpots);
+        //the low bits are the same for every aligned i32, so the address is mixed before picking a spot
+        u64 hash = (u64)(usize)address * 0x9E3779B97F4A7C15ull;
+        return &futexParkingSpots[(hash >> 32) % FUTEX_PARKING_SPOTS];
+    }
+    bool FutexWait(volatile i32 *address, i32 expected, u64 timeoutMilliseconds)
+    {
+        FutexParkingSpot *spot = FutexParkingSpotOf(address);
+        bool woken = true;
+        pthread_mutex_lock(&spot->mutex);
+        if (AtomicLoad32(address) == expected)
+        {
+            woken = ConditionTimedWait(&spot->condition, &spot->mutex, timeoutMilliseconds) != ETIMEDOUT;
+        }
+        pthread_mutex_unlock(&spot->mutex);
+        return woken;
+    }
+    //other addresses may be waiting on the same spot, so waking one still has to wake them all for the right one to see it
+    void FutexWakeOne(volatile i32 *address)
+    {
+        FutexWakeAll(address);
+    }
+    void FutexWakeAll(volatile i32 *address)
+    {
+        FutexParkingSpot *spot = FutexParkingSpotOf(address);
+        pthread_mutex_lock(&spot->mutex);
+        pthread_cond_broadcast(&spot->condition);
+        pthread_mutex_unlock(&spot->mutex);
+    }
+#endif
 }
 
 #endif
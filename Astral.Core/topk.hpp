@@ -0,0 +1,105 @@
+#pragma once
+#include "Linxc.h"
+#include "allocators.hpp"
+#include "vector.hpp"
+#include "sorting.hpp"
+
+namespace collections
+{
+    //Keeps the k items ordered first by Less out of any number of pushed items, using O(k) memory and O(log k) per kept item.
+    //Use OperatorGreater to keep the k largest (such as the highest scores) and OperatorLess for the k smallest.
+    //Internally a binary heap with the worst kept item at the root, so most items in a long stream are rejected with one compare.
+    template<typename T, typename Less = OperatorLess<T>>
+    struct topk
+    {
+        IAllocator allocator;
+        collections::vector<T> heap;
+        usize k;
+        Less less;
+
+        topk()
+        {
+            allocator = IAllocator{};
+            heap = collections::vector<T>();
+            k = 0;
+            less = Less();
+        }
+        topk(IAllocator myAllocator, usize k)
+        {
+            allocator = myAllocator;
+            heap = collections::vector<T>(myAllocator, k > 0 ? k : 1);
+            this->k = k;
+            less = Less();
+        }
+        topk(IAllocator myAllocator, usize k, Less comparator)
+        {
+            allocator = myAllocator;
+            heap = collections::vector<T>(myAllocator, k > 0 ? k : 1);
+            this->k = k;
+            less = comparator;
+        }
+        void deinit()
+        {
+            heap.deinit();
+        }
+        void Clear()
+        {
+            heap.count = 0;
+        }
+        inline usize Count()
+        {
+            return heap.count;
+        }
+        inline bool IsFull()
+        {
+            return heap.count == k;
+        }
+
+        //The last of the kept items, which any new item must be ordered before to be kept once full. NULL if empty
+        inline T *Worst()
+        {
+            return heap.count == 0 ? NULL : &heap.ptr[0];
+        }
+        //Returns whether the item is currently among the top k
+        bool Push(T item)
+        {
+            if (heap.count < k)
+            {
+                heap.Add(item);
+                usize index = heap.count - 1;
+                while (index > 0)
+                {
+                    usize parent = (index - 1) / 2;
+                    if (!less(heap.ptr[parent], item))
+                    {
+                        break;
+                    }
+                    heap.ptr[index] = heap.ptr[parent];
+                    index = parent;
+                }
+                heap.ptr[index] = item;
+                return true;
+            }
+            if (k == 0 || !less(item, heap.ptr[0]))
+            {
+                return false;
+            }
+            heap.ptr[0] = item;
+            HeapSiftDown(heap.ptr, 0, heap.count, less);
+            return true;
+        }
+        void PushAll(T *items, usize count)
+        {
+            for (usize i = 0; i < count; i++)
+            {
+                Push(items[i]);
+            }
+        }
+        //Copies the kept items into destination (which must hold Count() items), ordered from first to last
+        void CopySorted(T *destination)
+        {
+            SortCopy(destination, heap.ptr, heap.count);
+            IntroSort(destination, heap.count, less);
+        }
+    };
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "hash.hpp"
 #include "allocators.hpp"
 #include "string.hpp"
+#include "sorting.hpp"
 
 struct uuid
 {
@@ -105,6 +106,35 @@ struct uuid
     {
         return Murmur3(byte, 16);
     }
+    //the first and last 8 bytes as big endian integers, so that comparing (high, low) orders uuids by their bytes
+    inline u64 GetHighKey()
+    {
+        u64 result = 0;
+        for (usize i = 0; i < 8; i++)
+        {
+            result = (result << 8) | byte[i];
+        }
+        return result;
+    }
+    inline u64 GetLowKey()
+    {
+        u64 result = 0;
+        for (usize i = 8; i < 16; i++)
+        {
+            result = (result << 8) | byte[i];
+        }
+        return result;
+    }
+    inline bool operator<(uuid &other)
+    {
+        u64 high = GetHighKey();
+        u64 otherHigh = other.GetHighKey();
+        return high < otherHigh || (high == otherHigh && GetLowKey() < other.GetLowKey());
+    }
+    inline bool operator>(uuid &other)
+    {
+        return other < *this;
+    }
     inline void GetAsString(char* buffer)
     {
         buffer[8] = '-';
@@ -161,6 +191,34 @@ inline bool UuidEql(uuid A, uuid B)
     return A.Equals(B);
 }
 
+struct UuidHighKey
+{
+    inline u64 operator()(uuid &value)
+    {
+        return value.GetHighKey();
+    }
+};
+struct UuidLowKey
+{
+    inline u64 operator()(uuid &value)
+    {
+        return value.GetLowKey();
+    }
+};
+//Radix sorts uuids by their bytes. Since the sort is stable, sorting by the low half and then the high half orders by both
+inline void RadixSortUuids(uuid* array, usize arrayLength, IAllocator scratchAllocator)
+{
+    if (arrayLength < RADIX_SMALL_SORT_THRESHOLD)
+    {
+        IntroSort(array, arrayLength);
+        return;
+    }
+    uuid *scratch = (uuid*)scratchAllocator.Allocate(sizeof(uuid) * arrayLength);
+    RadixSortByKey(array, scratch, arrayLength, scratchAllocator, UuidLowKey());
+    RadixSortByKey(array, scratch, arrayLength, scratchAllocator, UuidHighKey());
+    scratchAllocator.Free(scratch);
+}
+
 #define UUID_STRINGIFY(uuidVarName, resultVarName) \
     char resultVarName[37];                        \
     resultVarName[36] = 0;                         \